@@ -0,0 +1,139 @@
+//! A shared pool of reusable I/O buffers for proxy connections.
+//!
+//! Each proxied stream needs a buffer per direction for as long as it
+//! lives.  Allocating those afresh for every connection creates avoidable
+//! allocator churn when connections are short-lived and frequent, so we
+//! keep a bounded free list of returned buffers and hand them back out to
+//! new connections.
+
+use std::ops::{Deref, DerefMut};
+use std::sync::{Arc, Mutex, Weak};
+
+/// Length of each pooled buffer.
+///
+/// 16 KiB is large enough to drain many relay cells' worth of queued data
+/// in a single read from a busy stream.
+pub(crate) const BUF_LEN: usize = 16 * 1024;
+
+/// A shared pool of I/O buffers.
+///
+/// Checking out a buffer reuses a previously returned allocation if one is
+/// idle, and allocates a new buffer otherwise.  Dropping a checked-out
+/// buffer returns it to the pool, unless the pool already holds its
+/// configured maximum number of idle buffers.
+pub(crate) struct BufferPool {
+    /// Idle buffers, waiting to be reused.
+    free: Mutex<Vec<Box<[u8; BUF_LEN]>>>,
+    /// Largest number of idle buffers to retain.
+    ///
+    /// (Setting this to 0 effectively disables pooling.)
+    max_idle: usize,
+}
+
+impl BufferPool {
+    /// Construct a new pool that retains at most `max_idle` idle buffers.
+    pub(crate) fn new(max_idle: usize) -> Arc<Self> {
+        Arc::new(BufferPool {
+            free: Mutex::new(Vec::new()),
+            max_idle,
+        })
+    }
+
+    /// Check a buffer out of the pool, allocating a new one if no idle
+    /// buffer is available.
+    pub(crate) fn checkout(self: &Arc<Self>) -> PooledBuffer {
+        let buf = self
+            .free
+            .lock()
+            .expect("buffer pool lock poisoned")
+            .pop()
+            .unwrap_or_else(|| Box::new([0_u8; BUF_LEN]));
+        PooledBuffer {
+            buf: Some(buf),
+            pool: Arc::downgrade(self),
+        }
+    }
+}
+
+/// A buffer checked out of a [`BufferPool`].
+///
+/// Dereferences to `[u8; BUF_LEN]`, and returns to its pool when dropped.
+pub(crate) struct PooledBuffer {
+    /// The buffer itself.  (Always present until we are dropped.)
+    buf: Option<Box<[u8; BUF_LEN]>>,
+    /// The pool to return the buffer to on drop.
+    ///
+    /// (Held weakly, so that outstanding buffers don't keep a discarded
+    /// pool alive.)
+    pool: Weak<BufferPool>,
+}
+
+impl Deref for PooledBuffer {
+    type Target = [u8; BUF_LEN];
+    fn deref(&self) -> &Self::Target {
+        self.buf.as_ref().expect("buffer taken before drop")
+    }
+}
+
+impl DerefMut for PooledBuffer {
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        self.buf.as_mut().expect("buffer taken before drop")
+    }
+}
+
+impl Drop for PooledBuffer {
+    fn drop(&mut self) {
+        if let (Some(buf), Some(pool)) = (self.buf.take(), self.pool.upgrade()) {
+            let mut free = pool.free.lock().expect("buffer pool lock poisoned");
+            if free.len() < pool.max_idle {
+                free.push(buf);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    // @@ begin test lint list maintained by maint/add_warning @@
+    #![allow(clippy::bool_assert_comparison)]
+    #![allow(clippy::clone_on_copy)]
+    #![allow(clippy::dbg_macro)]
+    #![allow(clippy::print_stderr)]
+    #![allow(clippy::print_stdout)]
+    #![allow(clippy::single_char_pattern)]
+    #![allow(clippy::unwrap_used)]
+    //! <!-- @@ end test lint list maintained by maint/add_warning @@ -->
+    use super::*;
+
+    #[test]
+    fn reuse_and_cap() {
+        let pool = BufferPool::new(1);
+
+        let mut b1 = pool.checkout();
+        let b2 = pool.checkout();
+        b1[0] = 99;
+        let b1_addr = b1.as_ptr() as usize;
+
+        // Returning two buffers to a max_idle=1 pool keeps only one.
+        drop(b1);
+        drop(b2);
+        assert_eq!(pool.free.lock().unwrap().len(), 1);
+
+        // The next checkout reuses the retained buffer (b1, returned
+        // first) rather than allocating.
+        let b3 = pool.checkout();
+        assert_eq!(b3.as_ptr() as usize, b1_addr);
+        assert_eq!(b3[0], 99);
+        assert_eq!(pool.free.lock().unwrap().len(), 0);
+    }
+
+    #[test]
+    fn outlives_pool() {
+        let pool = BufferPool::new(4);
+        let buf = pool.checkout();
+        drop(pool);
+        // Dropping the buffer after the pool is gone is fine; there is
+        // just nowhere to return it to.
+        drop(buf);
+    }
+}
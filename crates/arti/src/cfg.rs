@@ -70,6 +70,16 @@ pub struct ApplicationConfig {
     /// This has no effect on Windows.
     #[builder(default)]
     pub(crate) allow_running_as_root: bool,
+
+    /// Port on which to listen (on localhost) for HTTP scrapes of our
+    /// hot-path counters, in Prometheus text format.  0 (the default)
+    /// disables the listener.
+    ///
+    /// The counters themselves are always maintained (they are relaxed
+    /// atomics, cheap enough to leave on); this only controls whether
+    /// they are exported.
+    #[builder(default)]
+    pub(crate) metrics_port: u16,
 }
 impl_standard_builder! { ApplicationConfig }
 
@@ -137,6 +147,22 @@ pub struct ProxyConfig {
     )]
     #[builder_setter_attr(deprecated)]
     pub(crate) dns_port: (),
+
+    /// Maximum number of idle stream-copy buffers (of 16 KiB each) to
+    /// retain for reuse across proxy connections.
+    ///
+    /// Pooling these buffers reduces allocator churn when connections are
+    /// short-lived and frequent; 0 disables pooling.
+    #[builder(default = "64")]
+    pub(crate) stream_buffer_pool_size: usize,
+
+    /// Maximum number of entries in the DNS proxy's answer cache.
+    ///
+    /// Cached answers turn repeated resolutions of hot names from circuit
+    /// round trips into local lookups; answers are isolated per client,
+    /// and negative answers are kept only briefly.  0 disables caching.
+    #[builder(default = "256")]
+    pub(crate) dns_cache_size: usize,
 }
 impl_standard_builder! { ProxyConfig }
 
@@ -776,6 +802,15 @@ mod test {
                 "bridges",
                 "proxy.socks_listen",
                 "proxy.dns_listen",
+                "proxy.stream_buffer_pool_size",
+                "proxy.dns_cache_size",
+                "application.metrics_port",
+                "circuit_timing.exit_parallelism",
+                "channel.max_concurrent_handshakes",
+                "download_schedule.retry_bootstrap.hedge_delay",
+                "download_schedule.retry_consensus.hedge_delay",
+                "download_schedule.retry_certs.hedge_delay",
+                "download_schedule.retry_microdescs.hedge_delay",
             ],
         );
     }
@@ -9,6 +9,7 @@ use futures::task::SpawnExt;
 use std::collections::HashMap;
 use std::net::{IpAddr, Ipv4Addr, Ipv6Addr, SocketAddr};
 use std::sync::Arc;
+use std::time::{Duration, Instant};
 use tracing::{debug, error, info, warn};
 use trust_dns_proto::op::{
     header::MessageType, op_code::OpCode, response_code::ResponseCode, Message, Query,
@@ -24,6 +25,17 @@ use anyhow::{anyhow, Result};
 /// Maximum length for receiving a single datagram
 const MAX_DATAGRAM_SIZE: usize = 1536;
 
+/// How long to keep a successful resolution in the DNS cache.
+///
+/// (This matches the fixed TTL we put on the records we synthesize, since
+/// Tor's RESOLVED responses don't expose the upstream TTL to us here.)
+const POSITIVE_CACHE_TTL: Duration = Duration::from_secs(3600);
+
+/// How long to keep a negative ("no such records") answer in the DNS cache.
+///
+/// Kept short, as RFC 2308 advises for negative caching.
+const NEGATIVE_CACHE_TTL: Duration = Duration::from_secs(60);
+
 /// A Key used to isolate dns requests.
 ///
 /// Composed of an usize (representing which listener socket accepted
@@ -49,6 +61,75 @@ impl arti_client::isolation::IsolationHelper for DnsIsolationKey {
 #[derive(Debug, Clone, PartialEq, Eq, Hash)]
 struct DnsCacheKey(DnsIsolationKey, Vec<Query>);
 
+/// An answer to a DNS query, as stored in the cache: either a set of
+/// resource records, or a negative response code.
+type CachedAnswer = Result<Vec<Record>, ResponseCode>;
+
+/// A TTL-bounded cache of recent DNS answers, positive and negative.
+///
+/// Entries are keyed by the query (name, type and class) together with the
+/// isolation derived in the listener, so answers never leak between
+/// isolated clients.  Our workloads tend to re-resolve a small set of hot
+/// names constantly, and each miss costs a RESOLVE round trip over a
+/// circuit.
+struct DnsCache {
+    /// The cached answers, with their expiry times.
+    entries: HashMap<DnsCacheKey, (Instant, CachedAnswer)>,
+    /// Largest number of entries to retain.  (0 disables caching.)
+    max_entries: usize,
+}
+
+impl DnsCache {
+    /// Create a new cache holding at most `max_entries` answers.
+    fn new(max_entries: usize) -> Self {
+        DnsCache {
+            entries: HashMap::new(),
+            max_entries,
+        }
+    }
+
+    /// Return the unexpired cached answer for `key`, if there is one.
+    fn lookup(&mut self, key: &DnsCacheKey, now: Instant) -> Option<CachedAnswer> {
+        match self.entries.get(key) {
+            Some((expires, answer)) if *expires > now => Some(answer.clone()),
+            Some(_) => {
+                // Expired; drop it.
+                self.entries.remove(key);
+                None
+            }
+            None => None,
+        }
+    }
+
+    /// Store `answer` under `key`, if it is the kind of answer we cache.
+    ///
+    /// Successful resolutions and NODATA answers are cached; transient
+    /// failures (like SERVFAIL) and unsupported-query errors are not.
+    fn insert(&mut self, key: DnsCacheKey, answer: &CachedAnswer, now: Instant) {
+        if self.max_entries == 0 {
+            return;
+        }
+        let ttl = match answer {
+            Ok(_) => POSITIVE_CACHE_TTL,
+            // NoError with no body is NODATA (RFC 2308 section 2.2).
+            Err(ResponseCode::NoError) => NEGATIVE_CACHE_TTL,
+            Err(_) => return,
+        };
+        if self.entries.len() >= self.max_entries && !self.entries.contains_key(&key) {
+            // Make room: first drop anything expired, then (if we must)
+            // an arbitrary entry.  Simple, but good enough for a small
+            // cache of hot names.
+            self.entries.retain(|_, (expires, _)| *expires > now);
+            if self.entries.len() >= self.max_entries {
+                if let Some(victim) = self.entries.keys().next().cloned() {
+                    self.entries.remove(&victim);
+                }
+            }
+        }
+        self.entries.insert(key, (now + ttl, answer.clone()));
+    }
+}
+
 /// Target for a DNS response
 #[derive(Debug, Clone)]
 struct DnsResponseTarget<U> {
@@ -144,6 +225,27 @@ where
     Ok(answers)
 }
 
+/// Build a response to `query` out of `answer`.
+///
+/// (The caller still has to fix up the transaction ID for each recipient.)
+fn build_response(mut query: Message, answer: CachedAnswer) -> Message {
+    match answer {
+        Ok(answers) => {
+            let mut response = Message::new();
+            response
+                .set_message_type(MessageType::Response)
+                .set_op_code(OpCode::Query)
+                .set_recursion_desired(query.recursion_desired())
+                .set_recursion_available(true)
+                .add_queries(query.take_queries())
+                .add_answers(answers);
+            // TODO maybe add some edns?
+            response
+        }
+        Err(error_type) => Message::error_msg(query.id(), OpCode::Query, error_type),
+    }
+}
+
 /// Given a datagram containing a DNS query, resolve the query over
 /// the Tor network and send the response back.
 async fn handle_dns_req<R, U>(
@@ -153,25 +255,39 @@ async fn handle_dns_req<R, U>(
     addr: SocketAddr,
     socket: Arc<U>,
     current_requests: &Mutex<HashMap<DnsCacheKey, Vec<DnsResponseTarget<U>>>>,
+    cache: &Mutex<DnsCache>,
 ) -> Result<()>
 where
     R: Runtime,
     U: UdpSocket,
 {
     // if we can't parse the request, don't try to answer it.
-    let mut query = Message::from_bytes(packet)?;
+    let query = Message::from_bytes(packet)?;
     let id = query.id();
-    let queries = query.queries();
+    let queries = query.queries().to_vec();
     let isolation = DnsIsolationKey(socket_id, addr.ip());
+    let cache_key = DnsCacheKey(isolation.clone(), queries.clone());
 
-    let request_id = {
-        let request_id = DnsCacheKey(isolation.clone(), queries.to_vec());
+    // Answer straight out of the cache if we can.
+    if let Some(answer) = cache.lock().await.lookup(&cache_key, Instant::now()) {
+        debug!("Answering query from the DNS cache");
+        let mut response = build_response(query, answer);
+        response.set_id(id);
+        match response.to_bytes() {
+            Ok(bytes) => {
+                let _ = socket.send(&bytes, &addr).await;
+            }
+            Err(_) => error!("Failed to serialize DNS packet: {:?}", response),
+        }
+        return Ok(());
+    }
 
+    let request_id = {
         let response_target = DnsResponseTarget { id, addr, socket };
 
         let mut current_requests = current_requests.lock().await;
 
-        let req = current_requests.entry(request_id.clone()).or_default();
+        let req = current_requests.entry(cache_key.clone()).or_default();
         req.push(response_target);
 
         if req.len() > 1 {
@@ -180,27 +296,18 @@ where
         }
         debug!("Received a new query");
 
-        request_id
+        cache_key.clone()
     };
 
     let mut prefs = StreamPrefs::new();
     prefs.set_isolation(isolation);
 
-    let mut response = match do_query(tor_client, queries, &prefs).await {
-        Ok(answers) => {
-            let mut response = Message::new();
-            response
-                .set_message_type(MessageType::Response)
-                .set_op_code(OpCode::Query)
-                .set_recursion_desired(query.recursion_desired())
-                .set_recursion_available(true)
-                .add_queries(query.take_queries())
-                .add_answers(answers);
-            // TODO maybe add some edns?
-            response
-        }
-        Err(error_type) => Message::error_msg(id, OpCode::Query, error_type),
-    };
+    let answer = do_query(tor_client, &queries, &prefs).await;
+    cache
+        .lock()
+        .await
+        .insert(cache_key, &answer, Instant::now());
+    let mut response = build_response(query, answer);
 
     // remove() should never return None, but just in case
     let targets = current_requests
@@ -229,7 +336,9 @@ pub(crate) async fn run_dns_resolver<R: Runtime>(
     runtime: R,
     tor_client: TorClient<R>,
     dns_port: u16,
+    cache_size: usize,
 ) -> Result<()> {
+    let cache = Arc::new(Mutex::new(DnsCache::new(cache_size)));
     let mut listeners = Vec::new();
 
     // We actually listen on two ports: one for ipv4 and one for ipv6.
@@ -287,6 +396,7 @@ pub(crate) async fn run_dns_resolver<R: Runtime>(
         let client_ref = tor_client.clone();
         runtime.spawn({
             let pending_requests = pending_requests.clone();
+            let cache = cache.clone();
             async move {
                 let res = handle_dns_req(
                     client_ref,
@@ -295,6 +405,7 @@ pub(crate) async fn run_dns_resolver<R: Runtime>(
                     addr,
                     socket,
                     &pending_requests,
+                    &cache,
                 )
                 .await;
                 if let Err(e) = res {
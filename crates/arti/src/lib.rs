@@ -41,7 +41,9 @@
 #![allow(clippy::print_stderr)]
 #![allow(clippy::print_stdout)]
 
+mod bufpool;
 pub mod cfg;
+mod metrics;
 pub mod logging;
 
 #[cfg(all(feature = "experimental-api", feature = "dns-proxy"))]
@@ -145,14 +147,26 @@ async fn run<R: Runtime>(
         .config(client_config)
         .bootstrap_behavior(OnDemand);
     let client = client_builder.create_unbootstrapped()?;
+    let stream_buffer_pool_size = arti_config.proxy().stream_buffer_pool_size;
+    let metrics_port = arti_config.application().metrics_port;
+    #[cfg(feature = "dns-proxy")]
+    let dns_cache_size = arti_config.proxy().dns_cache_size;
     reload_cfg::watch_for_config_changes(config_sources, arti_config, client.clone())?;
 
     let mut proxy: Vec<PinnedFuture<(Result<()>, &str)>> = Vec::new();
+    if metrics_port != 0 {
+        let runtime = runtime.clone();
+        proxy.push(Box::pin(async move {
+            let res = metrics::run_metrics_listener(runtime, metrics_port).await;
+            (res, "Metrics")
+        }));
+    }
     if socks_port != 0 {
         let runtime = runtime.clone();
         let client = client.isolated_client();
         proxy.push(Box::pin(async move {
-            let res = socks::run_socks_proxy(runtime, client, socks_port).await;
+            let res =
+                socks::run_socks_proxy(runtime, client, socks_port, stream_buffer_pool_size).await;
             (res, "SOCKS")
         }));
     }
@@ -162,7 +176,7 @@ async fn run<R: Runtime>(
         let runtime = runtime.clone();
         let client = client.isolated_client();
         proxy.push(Box::pin(async move {
-            let res = dns::run_dns_resolver(runtime, client, dns_port).await;
+            let res = dns::run_dns_resolver(runtime, client, dns_port, dns_cache_size).await;
             (res, "DNS")
         }));
     }
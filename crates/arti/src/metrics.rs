@@ -0,0 +1,198 @@
+//! An optional localhost HTTP listener exposing hot-path counters in
+//! Prometheus text format.
+//!
+//! The counters themselves live in the crates that maintain them
+//! (`tor-proto`, `tor-circmgr`, `tor-dirmgr`) as relaxed atomics, so the
+//! hot paths never lock or format anything; all of the formatting happens
+//! here, when an operator actually scrapes `/metrics`.
+
+use std::net::{IpAddr, Ipv4Addr, SocketAddr};
+use std::sync::Arc;
+
+use anyhow::{anyhow, Result};
+use futures::io::AsyncWriteExt;
+use futures::stream::StreamExt;
+use futures::task::SpawnExt;
+use tor_rtcompat::{Runtime, TcpListener};
+use tracing::{info, warn};
+
+use crate::bufpool::BufferPool;
+
+/// Render every exported counter in Prometheus text exposition format.
+fn render_metrics() -> String {
+    use std::fmt::Write;
+
+    let mut out = String::with_capacity(1024);
+    /// Write one metric, with a HELP/TYPE preamble.
+    macro_rules! metric {
+        ($name:literal, $kind:literal, $help:literal, $value:expr) => {
+            let _ = writeln!(
+                out,
+                concat!(
+                    "# HELP ", $name, " ", $help, "\n",
+                    "# TYPE ", $name, " ", $kind, "\n",
+                    $name, " {}"
+                ),
+                $value
+            );
+        };
+    }
+
+    let proto = tor_proto::metrics::metrics();
+    metric!(
+        "arti_circ_cells_received_total",
+        "counter",
+        "Cells processed by circuit reactors (inbound).",
+        proto.circ_cells_received
+    );
+    metric!(
+        "arti_circ_cells_sent_total",
+        "counter",
+        "Cells encrypted and sent by circuit reactors.",
+        proto.circ_cells_sent
+    );
+    metric!(
+        "arti_chan_cells_received_total",
+        "counter",
+        "Cells received by channel reactors.",
+        proto.chan_cells_received
+    );
+    metric!(
+        "arti_chan_cells_sent_total",
+        "counter",
+        "Cells written to channels by channel reactors.",
+        proto.chan_cells_sent
+    );
+    metric!(
+        "arti_chan_cells_queued",
+        "gauge",
+        "Cells currently queued in channel output schedulers.",
+        proto.chan_cells_queued
+    );
+
+    let circmgr = tor_circmgr::metrics::metrics();
+    metric!(
+        "arti_circ_requests_total",
+        "counter",
+        "Completed circuit requests (streams attached or failed).",
+        circmgr.requests_total
+    );
+    metric!(
+        "arti_circ_requests_failed_total",
+        "counter",
+        "Circuit requests that ended in failure.",
+        circmgr.requests_failed
+    );
+    metric!(
+        "arti_circ_request_wait_microseconds_total",
+        "counter",
+        "Total time spent waiting for circuit requests.",
+        circmgr.request_wait_usec
+    );
+
+    let dirmgr = tor_dirmgr::metrics::metrics();
+    metric!(
+        "arti_dir_bootstrap_attempts_total",
+        "counter",
+        "Directory bootstrap attempts begun.",
+        dirmgr.bootstrap_attempts
+    );
+    if let Some(ms) = dirmgr.last_bootstrap_ms {
+        metric!(
+            "arti_dir_last_bootstrap_milliseconds",
+            "gauge",
+            "Duration of the most recent successful directory bootstrap.",
+            ms
+        );
+    }
+
+    out
+}
+
+/// Serve one scrape on `stream`: read (and discard) the request, and send
+/// back the rendered metrics as an HTTP/1.0 response.
+async fn serve_scrape<S>(mut stream: S, buffer_pool: &Arc<BufferPool>) -> Result<()>
+where
+    S: futures::io::AsyncRead + futures::io::AsyncWrite + Unpin,
+{
+    use futures::io::AsyncReadExt;
+
+    // Read a chunk of the request and then answer; we don't care what was
+    // asked, since we serve exactly one document.
+    let mut buf = buffer_pool.checkout();
+    let _ = stream.read(&mut buf[..]).await?;
+
+    let body = render_metrics();
+    let response = format!(
+        "HTTP/1.0 200 OK\r\n\
+         Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n\
+         Content-Length: {}\r\n\
+         \r\n\
+         {}",
+        body.len(),
+        body
+    );
+    stream.write_all(response.as_bytes()).await?;
+    stream.close().await?;
+    Ok(())
+}
+
+/// Launch a metrics listener on localhost at `port`, and run indefinitely.
+pub(crate) async fn run_metrics_listener<R: Runtime>(runtime: R, port: u16) -> Result<()> {
+    let addr: SocketAddr = (IpAddr::from(Ipv4Addr::LOCALHOST), port).into();
+    let listener = runtime
+        .listen(&addr)
+        .await
+        .map_err(|e| anyhow!("Can't listen on {}: {}", addr, e))?;
+    info!("Metrics listener on {:?}.", addr);
+
+    let buffer_pool = BufferPool::new(2);
+    let mut incoming = listener.incoming();
+    while let Some(stream) = incoming.next().await {
+        let (stream, _addr) = match stream {
+            Ok(s) => s,
+            Err(e) => {
+                warn!("Incoming metrics connection failed: {}", e);
+                continue;
+            }
+        };
+        let pool = Arc::clone(&buffer_pool);
+        runtime.spawn(async move {
+            if let Err(e) = serve_scrape(stream, &pool).await {
+                warn!("Metrics scrape failed: {}", e);
+            }
+        })?;
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod test {
+    // @@ begin test lint list maintained by maint/add_warning @@
+    #![allow(clippy::bool_assert_comparison)]
+    #![allow(clippy::clone_on_copy)]
+    #![allow(clippy::dbg_macro)]
+    #![allow(clippy::print_stderr)]
+    #![allow(clippy::print_stdout)]
+    #![allow(clippy::single_char_pattern)]
+    #![allow(clippy::unwrap_used)]
+    //! <!-- @@ end test lint list maintained by maint/add_warning @@ -->
+    use super::*;
+
+    #[test]
+    fn render_is_wellformed() {
+        let rendered = render_metrics();
+        // Every non-comment line is "name value".
+        for line in rendered.lines() {
+            if line.starts_with('#') {
+                continue;
+            }
+            let mut parts = line.split_ascii_whitespace();
+            let name = parts.next().unwrap();
+            assert!(name.starts_with("arti_"));
+            let value = parts.next().unwrap();
+            let _: f64 = value.parse().unwrap();
+            assert_eq!(parts.next(), None);
+        }
+    }
+}
@@ -10,12 +10,14 @@ use futures::task::SpawnExt;
 use safelog::sensitive;
 use std::io::Result as IoResult;
 use std::net::{IpAddr, Ipv4Addr, Ipv6Addr, SocketAddr};
+use std::sync::Arc;
 use tracing::{debug, error, info, warn};
 
 use arti_client::{ErrorKind, HasKind, StreamPrefs, TorClient};
 use tor_rtcompat::{Runtime, TcpListener};
 use tor_socksproto::{SocksAddr, SocksAuth, SocksCmd, SocksRequest};
 
+use crate::bufpool::{BufferPool, PooledBuffer};
 use anyhow::{anyhow, Context, Result};
 
 /// Payload to return when an HTTP connection arrive on a Socks port
@@ -98,6 +100,7 @@ async fn handle_socks_conn<R, S>(
     tor_client: TorClient<R>,
     socks_stream: S,
     isolation_info: (usize, IpAddr),
+    buffer_pool: Arc<BufferPool>,
 ) -> Result<()>
 where
     R: Runtime,
@@ -114,6 +117,8 @@ where
 
     let (mut socks_r, mut socks_w) = socks_stream.split();
     let mut inbuf = [0_u8; 1024];
+    // Buffer for handshake replies; they are at most two bytes each.
+    let mut replybuf = [0_u8; 16];
     let mut n_read = 0;
     let request = loop {
         // Read some more stuff.
@@ -123,7 +128,7 @@ where
             .context("Error while reading SOCKS handshake")?;
 
         // try to advance the handshake to the next state.
-        let action = match handshake.handshake(&inbuf[..n_read]) {
+        let action = match handshake.handshake_into(&inbuf[..n_read], &mut replybuf[..]) {
             Err(_) => continue, // Message truncated.
             Ok(Err(e)) => {
                 if let tor_socksproto::Error::BadProtocol(version) = e {
@@ -147,8 +152,8 @@ where
             inbuf.copy_within(action.drain..action.drain + n_read, 0);
             n_read -= action.drain;
         }
-        if !action.reply.is_empty() {
-            write_all_and_flush(&mut socks_w, &action.reply).await?;
+        if action.reply_len > 0 {
+            write_all_and_flush(&mut socks_w, &replybuf[..action.reply_len]).await?;
         }
         if action.finished {
             break handshake.into_request();
@@ -208,8 +213,8 @@ where
 
             // Finally, spawn two background tasks to relay traffic between
             // the socks stream and the tor stream.
-            runtime.spawn(copy_interactive(socks_r, tor_w).map(|_| ()))?;
-            runtime.spawn(copy_interactive(tor_r, socks_w).map(|_| ()))?;
+            runtime.spawn(copy_interactive(socks_r, tor_w, buffer_pool.checkout()).map(|_| ()))?;
+            runtime.spawn(copy_interactive(tor_r, socks_w, buffer_pool.checkout()).map(|_| ()))?;
         }
         SocksCmd::RESOLVE => {
             // We've been asked to perform a regular hostname lookup.
@@ -346,15 +351,13 @@ where
 /// This function assumes that the writer might need to be flushed for
 /// any buffered data to be sent.  It tries to minimize the number of
 /// flushes, however, by only flushing the writer when the reader has no data.
-async fn copy_interactive<R, W>(mut reader: R, mut writer: W) -> IoResult<()>
+async fn copy_interactive<R, W>(mut reader: R, mut writer: W, mut buf: PooledBuffer) -> IoResult<()>
 where
     R: AsyncRead + Unpin,
     W: AsyncWrite + Unpin,
 {
     use futures::{poll, task::Poll};
 
-    let mut buf = [0_u8; 1024];
-
     // At this point we could just loop, calling read().await,
     // write_all().await, and flush().await.  But we want to be more
     // clever than that: we only want to flush when the reader is
@@ -426,7 +429,11 @@ pub(crate) async fn run_socks_proxy<R: Runtime>(
     runtime: R,
     tor_client: TorClient<R>,
     socks_port: u16,
+    buffer_pool_size: usize,
 ) -> Result<()> {
+    // Buffers for stream copying are shared between connections, to
+    // reduce allocator pressure under connection churn.
+    let buffer_pool = BufferPool::new(buffer_pool_size);
     let mut listeners = Vec::new();
 
     // We actually listen on two ports: one for ipv4 and one for ipv6.
@@ -479,9 +486,11 @@ pub(crate) async fn run_socks_proxy<R: Runtime>(
         };
         let client_ref = tor_client.clone();
         let runtime_copy = runtime.clone();
+        let pool = Arc::clone(&buffer_pool);
         runtime.spawn(async move {
             let res =
-                handle_socks_conn(runtime_copy, client_ref, stream, (sock_id, addr.ip())).await;
+                handle_socks_conn(runtime_copy, client_ref, stream, (sock_id, addr.ip()), pool)
+                    .await;
             if let Err(e) = res {
                 warn!("connection exited with error: {}", e);
             }
@@ -0,0 +1,91 @@
+//! Benchmarks for the per-cell encode/decode hot path.
+//!
+//! Run with `cargo bench -p tor-cell`.
+
+use criterion::{black_box, criterion_group, criterion_main, BatchSize, Criterion};
+
+use bytes::BytesMut;
+use tor_cell::chancell::{codec::ChannelCodec, msg as chanmsg, ChanCell, CircId};
+use tor_cell::relaycell::{msg as relaymsg, RelayCell, StreamId};
+
+/// The link protocol to use when benchmarking the channel codec.
+const LINK_PROTOCOL: u16 = 4;
+
+/// Return a full-length DATA relay cell, as would be sent on a stream.
+fn example_relay_cell() -> RelayCell {
+    let body = vec![7_u8; relaymsg::Data::MAXLEN];
+    let data = relaymsg::Data::new(&body).expect("data message too long");
+    RelayCell::new(StreamId::from(1), data.into())
+}
+
+/// Benchmark RelayCell::encode of a full-length DATA cell.
+fn relaycell_encode(c: &mut Criterion) {
+    let mut rng = rand::thread_rng();
+    c.bench_function("relaycell_encode_data", |b| {
+        b.iter_batched(
+            example_relay_cell,
+            |cell| cell.encode(&mut rng).expect("encode failed"),
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+/// Benchmark RelayCell::decode of a full-length DATA cell.
+fn relaycell_decode(c: &mut Criterion) {
+    let mut rng = rand::thread_rng();
+    let body = example_relay_cell().encode(&mut rng).expect("encode failed");
+    c.bench_function("relaycell_decode_data", |b| {
+        b.iter(|| RelayCell::decode(black_box(body)).expect("decode failed"));
+    });
+}
+
+/// Benchmark ChannelCodec::write_cell of a RELAY channel cell.
+fn chancell_write(c: &mut Criterion) {
+    let mut rng = rand::thread_rng();
+    let body = example_relay_cell().encode(&mut rng).expect("encode failed");
+    let mut codec = ChannelCodec::new(LINK_PROTOCOL);
+    let mut dst = BytesMut::new();
+    c.bench_function("chancell_write_relay", |b| {
+        b.iter(|| {
+            dst.clear();
+            let relay = chanmsg::Relay::from_raw(body);
+            let cell = ChanCell::new(CircId::from(7), relay.into());
+            codec.write_cell(cell, &mut dst).expect("write failed");
+        });
+    });
+}
+
+/// Benchmark ChannelCodec::decode_cell of a RELAY channel cell.
+fn chancell_decode(c: &mut Criterion) {
+    let mut rng = rand::thread_rng();
+    let body = example_relay_cell().encode(&mut rng).expect("encode failed");
+    let mut codec = ChannelCodec::new(LINK_PROTOCOL);
+    let mut encoded = BytesMut::new();
+    let relay = chanmsg::Relay::from_raw(body);
+    codec
+        .write_cell(ChanCell::new(CircId::from(7), relay.into()), &mut encoded)
+        .expect("write failed");
+    let encoded = encoded.freeze();
+
+    c.bench_function("chancell_decode_relay", |b| {
+        b.iter_batched(
+            || BytesMut::from(&encoded[..]),
+            |mut src| {
+                codec
+                    .decode_cell(&mut src)
+                    .expect("decode failed")
+                    .expect("incomplete cell");
+            },
+            BatchSize::SmallInput,
+        );
+    });
+}
+
+criterion_group!(
+    cell_codec,
+    relaycell_encode,
+    relaycell_decode,
+    chancell_write,
+    chancell_decode
+);
+criterion_main!(cell_codec);
@@ -1,7 +1,7 @@
 //! Implementation for parsing and encoding relay cells
 
 use crate::chancell::{RawCellBody, CELL_DATA_LEN};
-use tor_bytes::{EncodeResult, Error, Result};
+use tor_bytes::{Error, Result};
 use tor_bytes::{Reader, Writer};
 use tor_error::internal;
 
@@ -214,47 +214,58 @@ impl RelayCell {
     /// Consume this relay message and encode it as a 509-byte padded cell
     /// body.
     pub fn encode<R: Rng + CryptoRng>(self, rng: &mut R) -> crate::Result<RawCellBody> {
-        /// We skip this much space before adding any random padding to the
-        /// end of the cell
-        const MIN_SPACE_BEFORE_PADDING: usize = 4;
-
-        // TODO: This implementation is inefficient; it copies too much.
-        let encoded = self.encode_to_vec()?;
-        let enc_len = encoded.len();
-        if enc_len > CELL_DATA_LEN {
-            return Err(crate::Error::Internal(internal!(
-                "too many bytes in relay cell"
-            )));
-        }
         let mut raw = [0_u8; CELL_DATA_LEN];
-        raw[0..enc_len].copy_from_slice(&encoded);
-
-        if enc_len < CELL_DATA_LEN - MIN_SPACE_BEFORE_PADDING {
-            rng.fill_bytes(&mut raw[enc_len + MIN_SPACE_BEFORE_PADDING..]);
-        }
-
+        self.encode_into(rng, &mut raw)?;
         Ok(raw)
     }
 
-    /// Consume a relay cell and return its contents, encoded for use
-    /// in a RELAY or RELAY_EARLY cell
+    /// Consume this relay message and encode it into the caller-provided
+    /// cell body, padding as in `encode`.
     ///
-    /// TODO: not the best interface, as this requires copying into a cell.
-    fn encode_to_vec(self) -> EncodeResult<Vec<u8>> {
-        let mut w = Vec::new();
+    /// The previous contents of `body` are entirely overwritten, so a
+    /// caller can reuse one body allocation across many cells.
+    pub fn encode_into<R: Rng + CryptoRng>(
+        self,
+        rng: &mut R,
+        body: &mut RawCellBody,
+    ) -> crate::Result<()> {
+        /// We skip this much space before adding any random padding to the
+        /// end of the cell
+        const MIN_SPACE_BEFORE_PADDING: usize = 4;
+
+        let mut w = BodyWriter {
+            body,
+            len: 0,
+            overflow: false,
+        };
         w.write_u8(self.msg.cmd().into());
         w.write_u16(0); // "Recognized"
         w.write_u16(self.streamid.0);
         w.write_u32(0); // Digest
-        let len_pos = w.len();
+        let len_pos = w.len;
         w.write_u16(0); // Length.
-        let body_pos = w.len();
+        let body_pos = w.len;
         self.msg.encode_onto(&mut w)?;
-        assert!(w.len() >= body_pos); // nothing was removed
-        let payload_len = w.len() - body_pos;
+        if w.overflow {
+            return Err(crate::Error::Internal(internal!(
+                "too many bytes in relay cell"
+            )));
+        }
+        let enc_len = w.len;
+        assert!(enc_len >= body_pos); // nothing was removed
+        let payload_len = enc_len - body_pos;
         assert!(payload_len <= std::u16::MAX as usize);
-        *(array_mut_ref![w, len_pos, 2]) = (payload_len as u16).to_be_bytes();
-        Ok(w)
+        *(array_mut_ref![body, len_pos, 2]) = (payload_len as u16).to_be_bytes();
+
+        // Since the body we were given may be reused, we have to clear
+        // anything that padding won't overwrite.
+        let zero_until = std::cmp::min(enc_len + MIN_SPACE_BEFORE_PADDING, CELL_DATA_LEN);
+        body[enc_len..zero_until].fill(0);
+        if enc_len < CELL_DATA_LEN - MIN_SPACE_BEFORE_PADDING {
+            rng.fill_bytes(&mut body[enc_len + MIN_SPACE_BEFORE_PADDING..]);
+        }
+
+        Ok(())
     }
     /// Parse a RELAY or RELAY_EARLY cell body into a RelayCell.
     ///
@@ -282,3 +293,29 @@ impl RelayCell {
         Ok(RelayCell { streamid, msg })
     }
 }
+
+/// Helper: a [`Writer`] that serializes into a fixed-size cell body,
+/// remembering whether it has overflowed instead of growing.
+struct BodyWriter<'a> {
+    /// The body we are writing into.
+    body: &'a mut RawCellBody,
+    /// How many bytes we have written so far.
+    len: usize,
+    /// True if a write would have run past the end of the body.
+    overflow: bool,
+}
+
+impl<'a> Writer for BodyWriter<'a> {
+    fn write_all(&mut self, b: &[u8]) {
+        if self.overflow {
+            return;
+        }
+        match self.body.get_mut(self.len..self.len + b.len()) {
+            Some(dest) => {
+                dest.copy_from_slice(b);
+                self.len += b.len();
+            }
+            None => self.overflow = true,
+        }
+    }
+}
@@ -202,7 +202,7 @@ impl msg::Body for ConnectUdp {
         })
     }
 
-    fn encode_onto(self, w: &mut Vec<u8>) -> EncodeResult<()> {
+    fn encode_onto<W: Writer>(self, w: &mut W) -> EncodeResult<()> {
         w.write_u32(self.flags.bits());
         w.write(&self.addr)?;
         Ok(())
@@ -250,7 +250,7 @@ impl msg::Body for ConnectedUdp {
         })
     }
 
-    fn encode_onto(self, w: &mut Vec<u8>) -> EncodeResult<()> {
+    fn encode_onto<W: Writer>(self, w: &mut W) -> EncodeResult<()> {
         w.write(&self.our_address)?;
         w.write(&self.their_address)?;
         Ok(())
@@ -315,8 +315,8 @@ impl msg::Body for Datagram {
         })
     }
 
-    fn encode_onto(mut self, w: &mut Vec<u8>) -> EncodeResult<()> {
-        w.append(&mut self.body);
+    fn encode_onto<W: Writer>(self, w: &mut W) -> EncodeResult<()> {
+        w.write_all(&self.body[..]);
         Ok(())
     }
 }
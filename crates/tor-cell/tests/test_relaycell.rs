@@ -58,6 +58,13 @@ fn cell(body: &str, id: StreamId, msg: RelayMsg) {
     let encoded2 = expected.encode(&mut bad_rng).unwrap();
 
     assert_eq!(&encoded1[..], &encoded2[..]);
+
+    // Encoding into a dirty, reused body must give the same bytes as a
+    // fresh encode.
+    let reparsed = RelayCell::decode(body).unwrap();
+    let mut reused = [0x55_u8; CELL_BODY_LEN];
+    reparsed.encode_into(&mut bad_rng, &mut reused).unwrap();
+    assert_eq!(&reused[..], &encoded1[..]);
 }
 
 #[test]
@@ -21,6 +21,16 @@ pub struct ChannelConfig {
     /// Control of channel padding
     #[builder(default)]
     pub(crate) padding: PaddingLevel,
+
+    /// Largest number of channel handshakes (TLS and link negotiation)
+    /// to run concurrently.  0 means no limit.
+    ///
+    /// When many channels are launched in a burst (for instance right
+    /// after bootstrapping), a cap keeps the handshakes from
+    /// oversubscribing the CPU; launches for user traffic are given
+    /// priority over directory launches while the cap is reached.
+    #[builder(default)]
+    pub(crate) max_concurrent_handshakes: usize,
 }
 impl_standard_builder! { ChannelConfig }
 
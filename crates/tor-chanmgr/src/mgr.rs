@@ -16,6 +16,7 @@ use tor_linkspec::{HasRelayIds, RelayIds};
 use tor_netdir::params::NetParameters;
 use tor_proto::channel::params::ChannelPaddingInstructionsUpdates;
 
+mod limit;
 mod state;
 
 /// Trait to describe as much of a
@@ -91,6 +92,9 @@ pub(crate) struct AbstractChanMgr<CF: AbstractChannelFactory> {
 
     /// A bootstrap reporter to give out when building channels.
     pub(crate) reporter: BootstrapReporter,
+
+    /// A cap on how many channel launches may run at once.
+    launch_limiter: limit::LaunchLimiter,
 }
 
 /// Type alias for a future that we wait on to see when a pending
@@ -113,6 +117,7 @@ impl<CF: AbstractChannelFactory + Clone> AbstractChanMgr<CF> {
         AbstractChanMgr {
             channels: state::MgrState::new(connector, config.clone(), dormancy, netparams),
             reporter,
+            launch_limiter: limit::LaunchLimiter::new(config.max_concurrent_handshakes),
         }
     }
 
@@ -158,7 +163,7 @@ impl<CF: AbstractChannelFactory + Clone> AbstractChanMgr<CF> {
     ) -> Result<(CF::Channel, ChanProvenance)> {
         use ChannelUsage as CU;
 
-        let chan = self.get_or_launch_internal(target).await?;
+        let chan = self.get_or_launch_internal(target, usage).await?;
 
         match usage {
             CU::Dir | CU::UselessCircuit => {}
@@ -172,6 +177,7 @@ impl<CF: AbstractChannelFactory + Clone> AbstractChanMgr<CF> {
     async fn get_or_launch_internal(
         &self,
         target: CF::BuildSpec,
+        usage: ChannelUsage,
     ) -> Result<(CF::Channel, ChanProvenance)> {
         /// How many times do we try?
         const N_ATTEMPTS: usize = 2;
@@ -232,6 +238,15 @@ impl<CF: AbstractChannelFactory + Clone> AbstractChanMgr<CF> {
                 }
                 // We need to launch a channel.
                 Some(Action::Launch(send)) => {
+                    // If too many handshakes are already running, wait for a
+                    // slot.  (User-traffic launches — our guard channels —
+                    // are released before directory launches.)  Requests for
+                    // this same target meanwhile wait on our pending entry,
+                    // so no duplicate launch starts.
+                    let _permit = self
+                        .launch_limiter
+                        .acquire(matches!(usage, ChannelUsage::UserTraffic))
+                        .await;
                     let connector = self.channels.builder();
                     let outcome = connector
                         .build_channel(&target, self.reporter.clone())
@@ -470,6 +485,8 @@ impl<CF: AbstractChannelFactory + Clone> AbstractChanMgr<CF> {
         config: &ChannelConfig,
         netparams: Arc<dyn AsRef<NetParameters>>,
     ) -> StdResult<(), tor_error::Bug> {
+        self.launch_limiter
+            .set_limit(config.max_concurrent_handshakes);
         self.channels
             .reconfigure_general(Some(config), None, netparams)
     }
@@ -0,0 +1,267 @@
+//! A limiter for concurrently-running channel launches.
+//!
+//! When many channels are launched in a burst (for example, right after
+//! bootstrapping), running every TLS and link handshake at once can
+//! oversubscribe the CPU and file descriptors without making any channel
+//! ready sooner.  A [`LaunchLimiter`] caps how many launches run at once;
+//! launches over the cap wait their turn, and launches for user traffic
+//! (that is, for circuits through our guards) are released before
+//! directory launches.
+
+use futures::channel::oneshot;
+use std::collections::VecDeque;
+use std::sync::{Arc, Mutex};
+
+/// A cap on concurrently-running channel launches.
+///
+/// Cloning this type gives another handle to the same limiter.
+#[derive(Clone)]
+pub(crate) struct LaunchLimiter {
+    /// Shared state.
+    inner: Arc<Mutex<LimiterState>>,
+}
+
+/// Mutable state for a [`LaunchLimiter`].
+struct LimiterState {
+    /// Largest number of launches to run at once.  (0 means no limit.)
+    limit: usize,
+    /// How many launches currently hold a permit.
+    active: usize,
+    /// Waiting high-priority (user-traffic) launches.
+    high: VecDeque<oneshot::Sender<()>>,
+    /// Waiting low-priority launches.
+    low: VecDeque<oneshot::Sender<()>>,
+}
+
+impl LaunchLimiter {
+    /// Construct a new limiter allowing `limit` concurrent launches.
+    /// (0 means unlimited.)
+    pub(crate) fn new(limit: usize) -> Self {
+        LaunchLimiter {
+            inner: Arc::new(Mutex::new(LimiterState {
+                limit,
+                active: 0,
+                high: VecDeque::new(),
+                low: VecDeque::new(),
+            })),
+        }
+    }
+
+    /// Change the limit, waking waiters if it was raised.
+    pub(crate) fn set_limit(&self, limit: usize) {
+        let mut state = self.inner.lock().expect("poisoned lock");
+        state.limit = limit;
+        // Wake as many waiters as now fit.  (A limit of 0 means unlimited.)
+        // If a woken waiter has meanwhile stopped listening, either the
+        // send fails here, or its TransferGuard releases the slot again.
+        while limit == 0 || state.active < limit {
+            match state.next_waiter() {
+                Some(waiter) => {
+                    if waiter.send(()).is_ok() {
+                        state.active += 1;
+                    }
+                    // (A failed send just means that waiter went away.)
+                }
+                None => break,
+            }
+        }
+    }
+
+    /// Wait until a launch slot is free, and claim it.
+    ///
+    /// The slot is held until the returned [`LaunchPermit`] is dropped.
+    ///
+    /// This future is cancellation-safe: if it is dropped after a slot was
+    /// transferred to it but before it could run, the slot is released
+    /// again.
+    pub(crate) async fn acquire(&self, high_priority: bool) -> LaunchPermit {
+        // NOTE: There must be no awaits between queueing our waiter and
+        // constructing the TransferGuard below, or a cancellation in
+        // between could leak a transferred slot.
+        let waiter = {
+            let mut state = self.inner.lock().expect("poisoned lock");
+            if state.limit == 0 || state.active < state.limit {
+                state.active += 1;
+                None
+            } else {
+                let (tx, rx) = oneshot::channel();
+                if high_priority {
+                    state.high.push_back(tx);
+                } else {
+                    state.low.push_back(tx);
+                }
+                Some(rx)
+            }
+        };
+        if let Some(rx) = waiter {
+            let mut guard = TransferGuard {
+                rx: Some(rx),
+                inner: Arc::clone(&self.inner),
+            };
+            // A successful recv means a dropped permit (or a raised limit)
+            // transferred a slot to us, with `active` counted on our
+            // behalf.  An error can only mean the limiter state is gone;
+            // proceed rather than deadlock.
+            let _ = guard.rx.as_mut().expect("rx taken early").await;
+            // We have accepted the slot (or the limiter is gone): disarm
+            // the guard so it doesn't give the slot back.
+            guard.rx = None;
+        }
+        LaunchPermit {
+            inner: Arc::clone(&self.inner),
+        }
+    }
+}
+
+/// Release one slot of `inner`: hand it to the next waiter that is still
+/// listening, or mark it free.
+fn release_slot(inner: &Mutex<LimiterState>) {
+    let mut state = inner.lock().expect("poisoned lock");
+    if state.limit != 0 && state.active > state.limit {
+        // The limit was lowered while this slot was held; just shed it.
+        state.active -= 1;
+        return;
+    }
+    while let Some(waiter) = state.next_waiter() {
+        if waiter.send(()).is_ok() {
+            // `active` stays the same: the slot has a new owner.  (If that
+            // owner has meanwhile stopped listening, its TransferGuard
+            // releases the slot again.)
+            return;
+        }
+    }
+    state.active = state.active.saturating_sub(1);
+}
+
+/// Guard used inside [`LaunchLimiter::acquire`] while waiting for a slot
+/// transfer.
+///
+/// Slot transfers leave `active` counted on the receiver's behalf, so if
+/// the acquiring future is cancelled after a transfer was sent but before
+/// it was received, the slot would leak.  Dropping this guard while it is
+/// still armed closes the receiver and, if a transfer had already
+/// arrived, releases the slot again.
+struct TransferGuard {
+    /// The transfer we are waiting for; None once the slot (or the
+    /// sender's disappearance) has been accepted.
+    rx: Option<oneshot::Receiver<()>>,
+    /// The limiter the slot belongs to.
+    inner: Arc<Mutex<LimiterState>>,
+}
+
+impl Drop for TransferGuard {
+    fn drop(&mut self) {
+        if let Some(mut rx) = self.rx.take() {
+            // Stop any future transfer from succeeding...
+            rx.close();
+            // ...and if one already succeeded, give the slot back.
+            if let Ok(Some(())) = rx.try_recv() {
+                release_slot(&self.inner);
+            }
+        }
+    }
+}
+
+impl LimiterState {
+    /// Remove and return the waiter that should run next, if any.
+    fn next_waiter(&mut self) -> Option<oneshot::Sender<()>> {
+        // User-traffic launches go first.
+        self.high.pop_front().or_else(|| self.low.pop_front())
+    }
+}
+
+/// A claim on one concurrent-launch slot; the slot is freed (or handed to
+/// a waiter) on drop.
+pub(crate) struct LaunchPermit {
+    /// The limiter the slot belongs to.
+    inner: Arc<Mutex<LimiterState>>,
+}
+
+impl Drop for LaunchPermit {
+    fn drop(&mut self) {
+        release_slot(&self.inner);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    // @@ begin test lint list maintained by maint/add_warning @@
+    #![allow(clippy::bool_assert_comparison)]
+    #![allow(clippy::clone_on_copy)]
+    #![allow(clippy::dbg_macro)]
+    #![allow(clippy::print_stderr)]
+    #![allow(clippy::print_stdout)]
+    #![allow(clippy::single_char_pattern)]
+    #![allow(clippy::unwrap_used)]
+    //! <!-- @@ end test lint list maintained by maint/add_warning @@ -->
+    use super::*;
+    use futures::FutureExt;
+
+    #[test]
+    fn limits_and_priorities() {
+        tor_rtcompat::test_with_one_runtime!(|_rt| async move {
+            let limiter = LaunchLimiter::new(2);
+
+            let p1 = limiter.acquire(false).await;
+            let _p2 = limiter.acquire(false).await;
+
+            // The limiter is full: a third acquire must wait.
+            let mut low = Box::pin(limiter.acquire(false));
+            assert!((&mut low).now_or_never().is_none());
+            // A high-priority acquire queued later still goes first.
+            let mut high = Box::pin(limiter.acquire(true));
+            assert!((&mut high).now_or_never().is_none());
+
+            drop(p1);
+            let _p3 = high.await;
+            assert!((&mut low).now_or_never().is_none());
+            drop(_p3);
+            let _p4 = low.await;
+        });
+    }
+
+    #[test]
+    fn cancelled_waiter_releases_transferred_slot() {
+        tor_rtcompat::test_with_one_runtime!(|_rt| async move {
+            let limiter = LaunchLimiter::new(1);
+            let p1 = limiter.acquire(false).await;
+
+            // Queue a waiter, then drop the permit: the slot is transferred
+            // to the waiter.
+            let mut waiting = Box::pin(limiter.acquire(false));
+            assert!((&mut waiting).now_or_never().is_none());
+            drop(p1);
+
+            // Cancel the waiter without ever polling it again.  The slot it
+            // was handed must be released, so a fresh acquire succeeds.
+            drop(waiting);
+            let _p2 = limiter
+                .acquire(false)
+                .now_or_never()
+                .expect("slot leaked by cancelled waiter");
+        });
+    }
+
+    #[test]
+    fn unlimited() {
+        tor_rtcompat::test_with_one_runtime!(|_rt| async move {
+            let limiter = LaunchLimiter::new(0);
+            let mut permits = Vec::new();
+            for _ in 0..100 {
+                permits.push(limiter.acquire(false).now_or_never().expect("blocked"));
+            }
+        });
+    }
+
+    #[test]
+    fn raise_limit_wakes_waiters() {
+        tor_rtcompat::test_with_one_runtime!(|_rt| async move {
+            let limiter = LaunchLimiter::new(1);
+            let _p1 = limiter.acquire(false).await;
+            let mut waiting = Box::pin(limiter.acquire(false));
+            assert!((&mut waiting).now_or_never().is_none());
+            limiter.set_limit(2);
+            let _p2 = waiting.await;
+        });
+    }
+}
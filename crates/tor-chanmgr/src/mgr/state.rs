@@ -717,7 +717,8 @@ mod test {
                     padding_parameters: Some(Parameters { \
                         low: IntegerMilliseconds { value: 1500 }, \
                         high: IntegerMilliseconds { value: 9500 } }), \
-                    padding_negotiate: None }"
+                    padding_negotiate: None, \
+                    scheduler_decay: None }"
             );
         });
         eprintln!();
@@ -330,6 +330,9 @@ pub struct CircuitBuilder<R: Runtime> {
     path_config: tor_config::MutCfg<crate::PathConfig>,
     /// State-manager object to use in storing current state.
     storage: crate::TimeoutStateHandle,
+    /// Configured timing/retry behavior, used for the launch-parallelism
+    /// knob.
+    circuit_timing: tor_config::MutCfg<crate::CircuitTiming>,
     /// Guard manager to tell us which guards nodes to use for the circuits
     /// we build.
     guardmgr: tor_guardmgr::GuardMgr<R>,
@@ -343,6 +346,7 @@ impl<R: Runtime> CircuitBuilder<R> {
         runtime: R,
         chanmgr: Arc<ChanMgr<R>>,
         path_config: crate::PathConfig,
+        circuit_timing: crate::CircuitTiming,
         storage: crate::TimeoutStateHandle,
         guardmgr: tor_guardmgr::GuardMgr<R>,
     ) -> Self {
@@ -352,10 +356,21 @@ impl<R: Runtime> CircuitBuilder<R> {
             builder: Arc::new(Builder::new(runtime, chanmgr, timeouts)),
             path_config: path_config.into(),
             storage,
+            circuit_timing: circuit_timing.into(),
             guardmgr,
         }
     }
 
+    /// Return this builder's [`CircuitTiming`](crate::CircuitTiming).
+    pub(crate) fn circuit_timing(&self) -> Arc<crate::CircuitTiming> {
+        self.circuit_timing.get()
+    }
+
+    /// Replace this builder's [`CircuitTiming`](crate::CircuitTiming).
+    pub(crate) fn set_circuit_timing(&self, new_config: crate::CircuitTiming) {
+        self.circuit_timing.replace(new_config);
+    }
+
     /// Return this builder's [`PathConfig`](crate::PathConfig).
     pub(crate) fn path_config(&self) -> Arc<crate::PathConfig> {
         self.path_config.get()
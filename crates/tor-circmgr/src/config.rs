@@ -196,6 +196,16 @@ pub struct CircuitTiming {
     #[builder(default = "default_request_loyalty()")]
     #[builder_field_attr(serde(default, with = "humantime_serde::option"))]
     pub(crate) request_loyalty: Duration,
+
+    /// How many exit circuits to launch in parallel (racing, first to
+    /// finish wins) when a request needs a new circuit.
+    ///
+    /// Values above 1 trade extra network load for lower tail latency on
+    /// circuit construction: the runners-up are kept in the circuit pool
+    /// for later requests rather than discarded.  The value 0 is treated
+    /// as 1.
+    #[builder(default = "1")]
+    pub(crate) exit_parallelism: u8,
 }
 impl_standard_builder! { CircuitTiming }
 
@@ -141,6 +141,12 @@ impl<R: Runtime> crate::mgr::AbstractCircBuilder for crate::build::CircuitBuilde
     fn launch_parallelism(&self, spec: &TargetCircUsage) -> usize {
         match spec {
             TargetCircUsage::Dir => 3,
+            // Race exit circuits for latency-critical (stream-driven)
+            // requests, if so configured.  Preemptive and testing builds
+            // are background work, so they stay serial.
+            TargetCircUsage::Exit { .. } => {
+                usize::from(std::cmp::max(1, self.circuit_timing().exit_parallelism))
+            }
             _ => 1,
         }
     }
@@ -59,6 +59,7 @@ mod config;
 mod err;
 mod impls;
 pub mod isolation;
+pub mod metrics;
 mod mgr;
 pub mod path;
 mod preemptive;
@@ -92,9 +93,15 @@ pub type Result<T> = std::result::Result<T, Error>;
 /// Type alias for dynamic StorageHandle that can handle our timeout state.
 type TimeoutStateHandle = tor_persist::DynStorageHandle<timeouts::pareto::ParetoTimeoutState>;
 
+/// Type alias for a StorageHandle to predicted-port state.
+type PredictedPortsStateHandle = tor_persist::DynStorageHandle<preemptive::PredictedPortsState>;
+
 /// Key used to load timeout state information.
 const PARETO_TIMEOUT_DATA_KEY: &str = "circuit_timeouts";
 
+/// Key used to load and store predicted-port information in a state manager.
+const PREDICTED_PORTS_DATA_KEY: &str = "predicted_ports";
+
 /// Represents what we know about the Tor network.
 ///
 /// This can either be a complete directory, or a list of fallbacks.
@@ -163,6 +170,9 @@ pub struct CircMgr<R: Runtime> {
     mgr: Arc<mgr::AbstractCircMgr<build::CircuitBuilder<R>, R>>,
     /// A preemptive circuit predictor, for, uh, building circuits preemptively.
     predictor: Arc<Mutex<PreemptiveCircuitPredictor>>,
+    /// State-manager handle used to persist the predictor's port set, so
+    /// that a restarted client can rebuild the right circuits immediately.
+    predicted_ports_storage: PredictedPortsStateHandle,
 }
 
 impl<R: Runtime> CircMgr<R> {
@@ -181,9 +191,17 @@ impl<R: Runtime> CircMgr<R> {
     where
         SM: tor_persist::StateMgr + Send + Sync + 'static,
     {
-        let preemptive = Arc::new(Mutex::new(PreemptiveCircuitPredictor::new(
-            config.preemptive_circuits().clone(),
-        )));
+        let mut predictor = PreemptiveCircuitPredictor::new(config.preemptive_circuits().clone());
+        // If an earlier run stored its predicted ports, start out
+        // predicting those too.
+        let predicted_ports_storage: PredictedPortsStateHandle =
+            storage.clone().create_handle(PREDICTED_PORTS_DATA_KEY);
+        match predicted_ports_storage.load() {
+            Ok(Some(state)) => predictor.import_state(state),
+            Ok(None) => (),
+            Err(e) => warn!("Unable to load predicted ports: {}", e),
+        }
+        let preemptive = Arc::new(Mutex::new(predictor));
 
         guardmgr.set_filter(config.path_rules().build_guard_filter());
 
@@ -193,6 +211,7 @@ impl<R: Runtime> CircMgr<R> {
             runtime.clone(),
             chanmgr,
             config.path_rules().clone(),
+            config.circuit_timing().clone(),
             storage_handle,
             guardmgr,
         );
@@ -201,6 +220,7 @@ impl<R: Runtime> CircMgr<R> {
         let circmgr = Arc::new(CircMgr {
             mgr: Arc::new(mgr),
             predictor: preemptive,
+            predicted_ports_storage,
         });
 
         Ok(circmgr)
@@ -310,6 +330,9 @@ impl<R: Runtime> CircMgr<R> {
         self.mgr
             .peek_builder()
             .set_path_config(new_config.path_rules().clone());
+        self.mgr
+            .peek_builder()
+            .set_circuit_timing(new_config.circuit_timing().clone());
         self.mgr
             .set_circuit_timing(new_config.circuit_timing().clone());
         predictor.set_config(new_config.preemptive_circuits().clone());
@@ -346,7 +369,18 @@ impl<R: Runtime> CircMgr<R> {
     ///
     /// Return true if we saved something; false if we didn't have the lock.
     pub fn store_persistent_state(&self) -> Result<bool> {
-        self.mgr.peek_builder().save_state()
+        let saved = self.mgr.peek_builder().save_state()?;
+        if saved {
+            // We hold the lock (save_state returned true), so we can store
+            // the predicted ports as well.
+            let state = self
+                .predictor
+                .lock()
+                .expect("preemptive lock poisoned")
+                .state();
+            self.predicted_ports_storage.store(&state)?;
+        }
+        Ok(saved)
     }
 
     /// Reconfigure this circuit manager using the latest set of
@@ -0,0 +1,54 @@
+//! Cheap global counters for instrumenting circuit requests.
+//!
+//! These are relaxed atomics (no locks, no formatting), cheap enough to
+//! leave enabled in production; an application can surface them to an
+//! operator, e.g. over a metrics endpoint.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Duration;
+
+/// Number of completed circuit requests (streams attached or failed).
+static REQUESTS_TOTAL: AtomicU64 = AtomicU64::new(0);
+/// Number of circuit requests that ended in failure.
+static REQUESTS_FAILED: AtomicU64 = AtomicU64::new(0);
+/// Total time spent waiting for circuit requests, in microseconds.
+///
+/// Together with `REQUESTS_TOTAL`, this gives a running average of how
+/// long a stream waits to be attached to a circuit.
+static REQUEST_WAIT_USEC: AtomicU64 = AtomicU64::new(0);
+
+/// Note the outcome of one circuit request: how long it took, and whether
+/// it succeeded.
+#[inline]
+pub(crate) fn note_request(wait: Duration, ok: bool) {
+    REQUESTS_TOTAL.fetch_add(1, Ordering::Relaxed);
+    if !ok {
+        REQUESTS_FAILED.fetch_add(1, Ordering::Relaxed);
+    }
+    let usec = u64::try_from(wait.as_micros()).unwrap_or(u64::MAX);
+    REQUEST_WAIT_USEC.fetch_add(usec, Ordering::Relaxed);
+}
+
+/// A snapshot of the circuit-request counters maintained by this crate.
+#[derive(Debug, Clone, Default)]
+#[non_exhaustive]
+pub struct CircMgrMetrics {
+    /// Number of completed circuit requests.
+    pub requests_total: u64,
+    /// Number of circuit requests that ended in failure.
+    pub requests_failed: u64,
+    /// Total time spent waiting for circuit requests, in microseconds.
+    pub request_wait_usec: u64,
+}
+
+/// Return a snapshot of this crate's counters.
+///
+/// (Each counter is read with relaxed ordering; the set is not a single
+/// consistent cut, which is fine for monitoring.)
+pub fn metrics() -> CircMgrMetrics {
+    CircMgrMetrics {
+        requests_total: REQUESTS_TOTAL.load(Ordering::Relaxed),
+        requests_failed: REQUESTS_FAILED.load(Ordering::Relaxed),
+        request_wait_usec: REQUEST_WAIT_USEC.load(Ordering::Relaxed),
+    }
+}
@@ -30,6 +30,7 @@ use tor_basic_utils::retry::RetryDelay;
 use tor_chanmgr::ChannelUsage;
 use tor_config::MutCfg;
 use tor_error::{internal, AbsRetryTime, HasRetryTime};
+use tor_rtcompat::wheel::TimerWheel;
 use tor_rtcompat::{Runtime, SleepProviderExt};
 
 use async_trait::async_trait;
@@ -105,6 +106,26 @@ pub(crate) trait AbstractSpec: Clone + Debug {
     /// contained by the original spec, and must support `usage`.
     fn restrict_mut(&mut self, usage: &Self::Usage) -> std::result::Result<(), RestrictionFailed>;
 
+    /// Type used to partition specifications into coarse "kinds", so that
+    /// open circuits can be indexed by kind rather than scanned one by
+    /// one.
+    type Kind: Clone + Eq + std::hash::Hash + Debug + Send + Sync + 'static;
+
+    /// Return the kind of this specification.
+    ///
+    /// # Requirements
+    ///
+    /// A specification's kind must never change: in particular,
+    /// `restrict_mut` must not affect it.
+    fn kind(&self) -> Self::Kind;
+
+    /// Return every kind of specification that could possibly support
+    /// `usage`.
+    ///
+    /// If a spec's kind is not in this list, then `spec.supports(usage)`
+    /// must be false.
+    fn kinds_for_usage(usage: &Self::Usage) -> Vec<Self::Kind>;
+
     /// Find all open circuits in `list` whose specifications permit
     /// `usage`.
     ///
@@ -493,8 +514,15 @@ struct CircList<B: AbstractCircBuilder> {
     /// that it completes successfully, and has not been cancelled.  
     /// When we decide that such a circuit should no longer be handed out for
     /// any new requests, we "retire" the circuit by removing it from this map.
+    /// The outer map is keyed by [`AbstractSpec::kind`], so that usage
+    /// requests only have to look at the buckets of circuits that could
+    /// possibly support them.  (A circuit's kind never changes, so entries
+    /// never migrate between buckets.)
     #[allow(clippy::type_complexity)]
-    open_circs: HashMap<<B::Circ as AbstractCirc>::Id, OpenEntry<B::Spec, B::Circ>>,
+    open_circs: HashMap<
+        <B::Spec as AbstractSpec>::Kind,
+        HashMap<<B::Circ as AbstractCirc>::Id, OpenEntry<B::Spec, B::Circ>>,
+    >,
     /// Weak-set of PendingEntry for circuits that are being built.
     ///
     /// Because this set only holds weak references, and the only strong
@@ -542,17 +570,25 @@ impl<B: AbstractCircBuilder> CircList<B> {
     /// Add `e` to the list of open circuits.
     fn add_open(&mut self, e: OpenEntry<B::Spec, B::Circ>) {
         let id = e.circ.id();
-        self.open_circs.insert(id, e);
+        self.open_circs.entry(e.spec.kind()).or_default().insert(id, e);
     }
 
     /// Find all the usable open circuits that support `usage`.
     ///
+    /// Only the buckets of circuit-kinds that could support `usage` are
+    /// scanned.
+    ///
     /// Return None if there are no such circuits.
     fn find_open(
         &mut self,
         usage: &<B::Spec as AbstractSpec>::Usage,
     ) -> Option<Vec<&mut OpenEntry<B::Spec, B::Circ>>> {
-        let list = self.open_circs.values_mut();
+        let kinds = <B::Spec as AbstractSpec>::kinds_for_usage(usage);
+        let list = self
+            .open_circs
+            .iter_mut()
+            .filter(|(kind, _)| kinds.contains(kind))
+            .flat_map(|(_, bucket)| bucket.values_mut());
         let v = <B::Spec as AbstractSpec>::find_supported(list, usage);
         if v.is_empty() {
             None
@@ -568,7 +604,9 @@ impl<B: AbstractCircBuilder> CircList<B> {
         &mut self,
         id: &<B::Circ as AbstractCirc>::Id,
     ) -> Option<&mut OpenEntry<B::Spec, B::Circ>> {
-        self.open_circs.get_mut(id)
+        self.open_circs
+            .values_mut()
+            .find_map(|bucket| bucket.get_mut(id))
     }
 
     /// Extract an open circuit by ID, removing it from this list.
@@ -578,7 +616,9 @@ impl<B: AbstractCircBuilder> CircList<B> {
         &mut self,
         id: &<B::Circ as AbstractCirc>::Id,
     ) -> Option<OpenEntry<B::Spec, B::Circ>> {
-        self.open_circs.remove(id)
+        self.open_circs
+            .values_mut()
+            .find_map(|bucket| bucket.remove(id))
     }
 
     /// Remove circuits based on expiration times.
@@ -587,8 +627,9 @@ impl<B: AbstractCircBuilder> CircList<B> {
     /// `unused_cutoff`, and every dirty circuit that has been dirty
     /// since before `dirty_cutoff`.
     fn expire_circs(&mut self, unused_cutoff: Instant, dirty_cutoff: Instant) {
-        self.open_circs
-            .retain(|_k, v| !v.should_expire(unused_cutoff, dirty_cutoff));
+        for bucket in self.open_circs.values_mut() {
+            bucket.retain(|_k, v| !v.should_expire(unused_cutoff, dirty_cutoff));
+        }
     }
 
     /// Remove the circuit with given `id`, if it is scheduled to
@@ -599,13 +640,15 @@ impl<B: AbstractCircBuilder> CircList<B> {
         unused_cutoff: Instant,
         dirty_cutoff: Instant,
     ) {
-        let should_expire = self
-            .open_circs
-            .get(id)
-            .map(|v| v.should_expire(unused_cutoff, dirty_cutoff))
-            .unwrap_or_else(|| false);
-        if should_expire {
-            self.open_circs.remove(id);
+        for bucket in self.open_circs.values_mut() {
+            let should_expire = bucket
+                .get(id)
+                .map(|v| v.should_expire(unused_cutoff, dirty_cutoff))
+                .unwrap_or_else(|| false);
+            if should_expire {
+                bucket.remove(id);
+                return;
+            }
         }
     }
 
@@ -739,8 +782,21 @@ pub(crate) struct AbstractCircMgr<B: AbstractCircBuilder, R: Runtime> {
     ///
     /// Derived from the network parameters.
     unused_timing: sync::Mutex<UnusedTimings>,
+
+    /// A shared coarse timer for circuit-expiration wakeups, created
+    /// lazily the first time an expiration is scheduled.
+    ///
+    /// Using one [`TimerWheel`] instead of a runtime timer per circuit
+    /// keeps a busy client's timer population small.
+    timer_wheel: sync::Mutex<Option<TimerWheel>>,
 }
 
+/// Tick granularity for the shared circuit-expiration timer.
+///
+/// Expiration times are on the order of minutes, so one second of extra
+/// delay is harmless.
+const EXPIRATION_WHEEL_GRANULARITY: Duration = Duration::from_secs(1);
+
 /// An action to take in order to satisfy a request for a circuit.
 enum Action<B: AbstractCircBuilder> {
     /// We found an open circuit: return immediately.
@@ -765,9 +821,23 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
             circs,
             circuit_timing: circuit_timing.into(),
             unused_timing: sync::Mutex::new(unused_timing),
+            timer_wheel: sync::Mutex::new(None),
         }
     }
 
+    /// Return a handle to this manager's shared expiration timer,
+    /// creating it (and spawning its driver task) on first use.
+    ///
+    /// Returns None if the driver task can't be spawned (e.g. at
+    /// shutdown); callers then fall back to a plain runtime timer.
+    fn timer_wheel(&self) -> Option<TimerWheel> {
+        let mut wheel = self.timer_wheel.lock().expect("poisoned lock");
+        if wheel.is_none() {
+            *wheel = TimerWheel::new(&self.runtime, EXPIRATION_WHEEL_GRANULARITY).ok();
+        }
+        wheel.clone()
+    }
+
     /// Reconfigure this manager using the latest set of network parameters.
     pub(crate) fn update_network_parameters(&self, p: &tor_netdir::params::NetParameters) {
         let mut u = self
@@ -795,6 +865,24 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
         self: &Arc<Self>,
         usage: &<B::Spec as AbstractSpec>::Usage,
         dir: DirInfo<'_>,
+    ) -> Result<(B::Circ, CircProvenance)> {
+        let started = self.runtime.now();
+        let outcome = self.get_or_launch_inner(usage, dir).await;
+        crate::metrics::note_request(
+            self.runtime
+                .now()
+                .saturating_duration_since(started),
+            outcome.is_ok(),
+        );
+        outcome
+    }
+
+    /// Helper for [`Self::get_or_launch`]: does all the work, without the
+    /// instrumentation.
+    async fn get_or_launch_inner(
+        self: &Arc<Self>,
+        usage: &<B::Spec as AbstractSpec>::Usage,
+        dir: DirInfo<'_>,
     ) -> Result<(B::Circ, CircProvenance)> {
         /// Return CEIL(a/b).
         ///
@@ -1127,6 +1215,7 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
                                     // Since this circuit hasn't been used yet, schedule expiration task after `max_dirtiness` from now.
                                     spawn_expiration_task(
                                         &self.runtime,
+                                        self.timer_wheel(),
                                         Arc::downgrade(&self),
                                         ent.circ.id(),
                                         now + self.circuit_timing().max_dirtiness,
@@ -1329,7 +1418,13 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
                 let use_duration = self.pick_use_duration();
                 let exp_inst = self.runtime.now() + use_duration;
                 let runtime_copy = self.runtime.clone();
-                spawn_expiration_task(&runtime_copy, Arc::downgrade(&self), circ.id(), exp_inst);
+                spawn_expiration_task(
+                    &runtime_copy,
+                    self.timer_wheel(),
+                    Arc::downgrade(&self),
+                    circ.id(),
+                    exp_inst,
+                );
                 // I used to call restrict_mut here, but now I'm not so
                 // sure. Doing restrict_mut makes sure that this
                 // circuit will be suitable for the request that asked
@@ -1419,7 +1514,7 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
     /// Return the number of open circuits held by this circuit manager.
     pub(crate) fn n_circs(&self) -> usize {
         let list = self.circs.lock().expect("poisoned lock");
-        list.open_circs.len()
+        list.open_circs.values().map(HashMap::len).sum()
     }
 
     /// Return the number of pending circuits tracked by this circuit manager.
@@ -1470,6 +1565,7 @@ impl<B: AbstractCircBuilder + 'static, R: Runtime> AbstractCircMgr<B, R> {
 /// is ready to expire.
 fn spawn_expiration_task<B, R>(
     runtime: &R,
+    wheel: Option<TimerWheel>,
     circmgr: Weak<AbstractCircMgr<B, R>>,
     circ_id: <<B as AbstractCircBuilder>::Circ as AbstractCirc>::Id,
     exp_inst: Instant,
@@ -1493,7 +1589,11 @@ fn spawn_expiration_task<B, R>(
     } else {
         // Spawn a timer expiration task with given expiration instant.
         if let Err(e) = runtime.spawn(async move {
-            rt_copy.sleep(duration).await;
+            match wheel {
+                // Share one runtime timer with every other expiration.
+                Some(wheel) => wheel.sleep_at(exp_inst).await,
+                None => rt_copy.sleep(duration).await,
+            }
             let cm = if let Some(cm) = Weak::upgrade(&circmgr) {
                 cm
             } else {
@@ -1574,6 +1674,11 @@ mod test {
 
     impl AbstractSpec for FakeSpec {
         type Usage = FakeSpec;
+        type Kind = ();
+        fn kind(&self) {}
+        fn kinds_for_usage(_usage: &FakeSpec) -> Vec<()> {
+            vec![()]
+        }
         fn supports(&self, other: &FakeSpec) -> bool {
             let ports_ok = self.ports.is_superset(&other.ports);
             let iso_ok = match (self.isolation, other.isolation) {
@@ -1,11 +1,23 @@
 //! Tools for determining what circuits to preemptively build.
 
 use crate::{PreemptiveCircuitConfig, TargetCircUsage, TargetPort};
+use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
 use std::sync::Arc;
 use std::time::Instant;
 use tracing::warn;
 
+/// Persistent state for a [`PreemptiveCircuitPredictor`].
+///
+/// This records the set of recently predicted ports, so that a newly
+/// started client can begin rebuilding the same preemptive circuits
+/// immediately, instead of waiting to re-observe its user's traffic.
+#[derive(Clone, Debug, Serialize, Deserialize)]
+pub(crate) struct PredictedPortsState {
+    /// The ports in the predicted set.
+    ports: Vec<TargetPort>,
+}
+
 /// Predicts what circuits might be used in future based on past activity, and suggests
 /// circuits to preemptively build as a result.
 pub(crate) struct PreemptiveCircuitPredictor {
@@ -73,6 +85,35 @@ impl PreemptiveCircuitPredictor {
             .collect()
     }
 
+    /// Return the currently predicted ports, in a form suitable for
+    /// storing to disk.
+    ///
+    /// Ports whose predictions have already expired are not included.
+    pub(crate) fn state(&self) -> PredictedPortsState {
+        let config = self.config();
+        let now = Instant::now();
+        let ports = self
+            .usages
+            .iter()
+            .filter(|(_, &time)| {
+                time.checked_add(config.prediction_lifetime)
+                    .map(|t| t > now)
+                    .unwrap_or(false)
+            })
+            .filter_map(|(&port, _)| port)
+            .collect();
+        PredictedPortsState { ports }
+    }
+
+    /// Add the ports recorded in `state` — presumably by an earlier run —
+    /// to the predicted set, treating each as if it had just been used.
+    pub(crate) fn import_state(&mut self, state: PredictedPortsState) {
+        let now = Instant::now();
+        for port in state.ports {
+            self.usages.insert(Some(port), now);
+        }
+    }
+
     /// Note the use of a new port at the provided `time`.
     ///
     /// # Limitations
@@ -169,6 +210,40 @@ mod test {
             })));
     }
 
+    #[test]
+    fn state_roundtrip() {
+        let mut cfg = PreemptiveCircuitConfig::builder();
+        cfg.set_initial_predicted_ports(vec![]);
+        cfg.prediction_lifetime(Duration::from_secs(2));
+        let cfg = cfg.build().unwrap();
+        let mut predictor = PreemptiveCircuitPredictor::new(cfg.clone());
+        let now = Instant::now();
+
+        predictor.note_usage(Some(TargetPort::ipv4(443)), now);
+        // An expired port should not be stored.
+        predictor.note_usage(Some(TargetPort::ipv4(2345)), now - Duration::from_secs(2 + 1));
+
+        // A predictor seeded from the stored state should predict the
+        // same (live) ports as the original.
+        let mut restarted = PreemptiveCircuitPredictor::new(cfg);
+        restarted.import_state(predictor.state());
+
+        let results = restarted.predict();
+        assert_eq!(results.len(), 2);
+        assert!(results
+            .iter()
+            .any(|r| r.isol_eq(&TargetCircUsage::Preemptive {
+                port: Some(TargetPort::ipv4(443)),
+                circs: 2
+            })));
+        assert!(!results
+            .iter()
+            .any(|r| r.isol_eq(&TargetCircUsage::Preemptive {
+                port: Some(TargetPort::ipv4(2345)),
+                circs: 2
+            })));
+    }
+
     #[test]
     fn does_not_predict_old_ports() {
         let mut cfg = PreemptiveCircuitConfig::builder();
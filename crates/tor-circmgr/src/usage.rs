@@ -281,8 +281,51 @@ fn owned_targets_equivalent(a: &OwnedChanTarget, b: &OwnedChanTarget) -> bool {
     a.same_relay_ids(b) && a.chan_method() == b.chan_method()
 }
 
+/// A coarse classification of circuits by what they can possibly be used
+/// for, used to index open circuits.
+///
+/// (Restricting a circuit's usage never changes its kind: an exit circuit
+/// stays an exit circuit when it acquires an isolation group.)
+#[derive(Copy, Clone, Debug, Eq, PartialEq, Hash)]
+pub(crate) enum CircKind {
+    /// A directory circuit.
+    Dir,
+    /// An exit circuit (whether or not it has an isolation group yet).
+    Exit,
+    /// A circuit unsuitable for any use.
+    NoUsage,
+    /// A directory circuit to one specific target.
+    #[cfg(feature = "specific-relay")]
+    DirSpecific,
+}
+
 impl crate::mgr::AbstractSpec for SupportedCircUsage {
     type Usage = TargetCircUsage;
+    type Kind = CircKind;
+
+    fn kind(&self) -> CircKind {
+        match self {
+            SupportedCircUsage::Dir => CircKind::Dir,
+            SupportedCircUsage::Exit { .. } => CircKind::Exit,
+            SupportedCircUsage::NoUsage => CircKind::NoUsage,
+            #[cfg(feature = "specific-relay")]
+            SupportedCircUsage::DirSpecificTarget(_) => CircKind::DirSpecific,
+        }
+    }
+
+    fn kinds_for_usage(usage: &TargetCircUsage) -> Vec<CircKind> {
+        // (This must list every kind for which `supports` can return true;
+        // see the match there.)
+        match usage {
+            TargetCircUsage::Dir => vec![CircKind::Dir],
+            TargetCircUsage::Exit { .. } | TargetCircUsage::Preemptive { .. } => {
+                vec![CircKind::Exit]
+            }
+            TargetCircUsage::TimeoutTesting => vec![CircKind::Exit, CircKind::NoUsage],
+            #[cfg(feature = "specific-relay")]
+            TargetCircUsage::DirSpecificTarget(_) => vec![CircKind::DirSpecific],
+        }
+    }
 
     fn supports(&self, target: &TargetCircUsage) -> bool {
         use SupportedCircUsage::*;
@@ -97,6 +97,15 @@ impl RoundtripTimeEstimator {
         }
     }
 
+    /// Create a new `RoundtripTimeEstimator` using the default network
+    /// parameters.
+    ///
+    /// This is for callers that have no convenient access to a set of
+    /// [`NetParameters`], such as per-circuit code in lower-level crates.
+    pub fn new_with_default_params(clock_stalled: Arc<AtomicBool>) -> Self {
+        Self::new(&NetParameters::default(), clock_stalled)
+    }
+
     /// Inform the estimator that we did (at time `now) something that we'll expect a SENDME to
     /// be received for.
     pub fn expect_sendme(&mut self, now: Instant) {
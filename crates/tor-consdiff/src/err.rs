@@ -3,6 +3,7 @@
 use thiserror::Error;
 
 use std::num::ParseIntError;
+use std::sync::Arc;
 
 /// An error type from the tor-consdiff crate.
 #[derive(Clone, Debug, Error)]
@@ -18,6 +19,16 @@ pub enum Error {
     /// to the given input.
     #[error("Diff didn't apply to input: {0}")]
     CantApply(&'static str),
+
+    /// We couldn't write the output of a diff to its destination.
+    #[error("Unable to write diff output")]
+    WriteFailed(#[source] Arc<std::io::Error>),
+}
+
+impl From<std::io::Error> for Error {
+    fn from(e: std::io::Error) -> Error {
+        Error::WriteFailed(Arc::new(e))
+    }
 }
 
 impl From<ParseIntError> for Error {
@@ -525,6 +525,40 @@ impl<'a> DiffResult<'a> {
         }
     }
 
+    /// Return the length of this result, in bytes, when assembled.
+    pub fn byte_len(&self) -> usize {
+        // (Each line is emitted followed by a newline.)
+        self.lines.iter().map(|line| line.len() + 1).sum()
+    }
+
+    /// Write this result incrementally to `w`, computing its digest as the
+    /// output is produced, and check the digest against the one the diff
+    /// promised.
+    ///
+    /// This is equivalent to `check_digest` followed by writing the
+    /// `Display` output, but makes a single pass over the document and
+    /// never assembles it in memory, so callers can hash and store a
+    /// patched consensus as it is emitted.
+    ///
+    /// Give an error (after possibly having written part of the output!)
+    /// if the digest does not match or if `w` fails.
+    pub fn write_and_check_digest<W: std::io::Write>(&self, w: &mut W) -> Result<()> {
+        use digest::Digest;
+        use tor_llcrypto::d::Sha3_256;
+        let mut d = Sha3_256::new();
+        for line in &self.lines {
+            d.update(line.as_bytes());
+            d.update(b"\n");
+            w.write_all(line.as_bytes())?;
+            w.write_all(b"\n")?;
+        }
+        if d.finalize() == self.d_post.into() {
+            Ok(())
+        } else {
+            Err(Error::CantApply("Wrong digest after applying diff"))
+        }
+    }
+
     /// See whether the output of this diff matches the target digest.
     ///
     /// If not, return an error.
@@ -865,6 +899,28 @@ hash B03DA3ACA1D3C1D083E3FF97873002416EBD81A058B406D5C5946EAB53A79663 F6789F35B6
         assert_eq!(result.to_string(), post);
     }
 
+    #[test]
+    fn write_streaming() {
+        let pre = include_str!("../testdata/consensus1.txt");
+        let diff = include_str!("../testdata/diff1.txt");
+        let post = include_str!("../testdata/consensus2.txt");
+
+        let result = apply_diff(pre, diff, None).unwrap();
+        assert_eq!(result.byte_len(), post.len());
+
+        // The streaming output must agree with the Display output, and the
+        // digest computed along the way must check out.
+        let mut buf = Vec::with_capacity(result.byte_len());
+        result.write_and_check_digest(&mut buf).unwrap();
+        assert_eq!(std::str::from_utf8(&buf).unwrap(), post);
+
+        // A result with a wrong expected digest fails the streaming check.
+        let mut bad = result.clone();
+        bad.d_post = [99; 32];
+        let mut buf = Vec::new();
+        assert!(bad.write_and_check_digest(&mut buf).is_err());
+    }
+
     #[test]
     fn sort_order() -> Result<()> {
         fn cmds(s: &str) -> Result<Vec<DiffCommand<'_>>> {
@@ -57,6 +57,7 @@ use futures::io::{
 };
 use futures::FutureExt;
 use memchr::memchr;
+use std::sync::atomic::{AtomicU64, Ordering};
 use std::sync::Arc;
 use std::time::Duration;
 use tracing::info;
@@ -94,7 +95,130 @@ where
     SP: SleepProvider,
 {
     let circuit = circ_mgr.get_or_launch_dir(dirinfo).await?;
+    get_resource_on_circuit(req, circuit, runtime, &circ_mgr).await
+}
+
+/// As [`get_resource`], but if the request goes `hedge_delay` without
+/// receiving any response bytes, launch the same request a second time on
+/// a fresh circuit (and thus, usually, to a different cache), and take
+/// whichever attempt finishes first.
+///
+/// A request that is slow but still streaming data is never hedged: the
+/// timer is effectively reset whenever body bytes arrive, so only a cache
+/// that has gone silent for a full `hedge_delay` triggers the duplicate
+/// request.  (The hedge may fire up to one extra `hedge_delay` after the
+/// silence began, since progress is checked at `hedge_delay` intervals.)
+///
+/// The slow attempt keeps running until the other finishes successfully,
+/// at which point it is cancelled by being dropped; if the faster attempt
+/// fails, we fall back to waiting for the slower one.  Each attempt
+/// reports its own cache as the source of its response or error, so blame
+/// for a failure still lands on the cache that caused it.
+pub async fn get_resource_hedged<CR, R, SP>(
+    req: &CR,
+    dirinfo: DirInfo<'_>,
+    runtime: &SP,
+    circ_mgr: Arc<CircMgr<R>>,
+    hedge_delay: Duration,
+) -> Result<DirResponse>
+where
+    CR: request::Requestable + ?Sized,
+    R: Runtime,
+    SP: SleepProvider,
+{
+    use futures::future::{self, Either};
+
+    let circuit = circ_mgr.get_or_launch_dir(dirinfo).await?;
+    let circ_id = circuit.unique_id();
+    let progress = AtomicU64::new(0);
+    let mut first = Box::pin(get_resource_on_circuit_counting(
+        req,
+        circuit,
+        runtime,
+        &circ_mgr,
+        Some(&progress),
+    ));
+
+    // Wait for the request to either finish, or go a full `hedge_delay`
+    // without receiving any bytes.
+    let mut bytes_seen = 0;
+    loop {
+        let timer = Box::pin(runtime.sleep(hedge_delay));
+        match future::select(first, timer).await {
+            Either::Left((result, _)) => return result,
+            Either::Right(((), f)) => {
+                first = f;
+                let bytes_now = progress.load(Ordering::Relaxed);
+                if bytes_now == bytes_seen {
+                    // No bytes arrived since we last checked: hedge.
+                    break;
+                }
+                bytes_seen = bytes_now;
+            }
+        }
+    }
+
+    // The first cache has gone silent.  Retire its circuit from the
+    // manager (the attempt itself keeps using it), so that the hedged
+    // attempt gets a fresh circuit instead of being handed the same slow
+    // one back.
+    circ_mgr.retire_circ(&circ_id);
+    let second = Box::pin(async {
+        let circuit = circ_mgr.get_or_launch_dir(dirinfo).await?;
+        get_resource_on_circuit(req, circuit, runtime, &circ_mgr).await
+    });
+
+    let result = match future::select(first, second).await {
+        Either::Left((result, second)) => {
+            if result.is_ok() {
+                result
+            } else {
+                second.await
+            }
+        }
+        Either::Right((result, first)) => {
+            if result.is_ok() {
+                result
+            } else {
+                first.await
+            }
+        }
+    };
+    result
+}
+
+/// Helper: fetch a directory resource over a directory circuit we've
+/// already obtained.
+///
+/// (This is the bulk of `get_resource`.)
+async fn get_resource_on_circuit<CR, R, SP>(
+    req: &CR,
+    circuit: tor_proto::circuit::ClientCirc,
+    runtime: &SP,
+    circ_mgr: &Arc<CircMgr<R>>,
+) -> Result<DirResponse>
+where
+    CR: request::Requestable + ?Sized,
+    R: Runtime,
+    SP: SleepProvider,
+{
+    get_resource_on_circuit_counting(req, circuit, runtime, circ_mgr, None).await
+}
 
+/// As [`get_resource_on_circuit`], but count received body bytes into
+/// `progress` if it is provided.
+async fn get_resource_on_circuit_counting<CR, R, SP>(
+    req: &CR,
+    circuit: tor_proto::circuit::ClientCirc,
+    runtime: &SP,
+    circ_mgr: &Arc<CircMgr<R>>,
+    progress: Option<&AtomicU64>,
+) -> Result<DirResponse>
+where
+    CR: request::Requestable + ?Sized,
+    R: Runtime,
+    SP: SleepProvider,
+{
     // TODO(nickm) This should be an option, and is too long.
     let begin_timeout = Duration::from_secs(5);
     let source = SourceInfo::from_circuit(&circuit);
@@ -119,10 +243,10 @@ where
 
     // TODO: Perhaps we want separate timeouts for each phase of this.
     // For now, we just use higher-level timeouts in `dirmgr`.
-    let r = download(runtime, req, &mut stream, Some(source.clone())).await;
+    let r = download_counting(runtime, req, &mut stream, Some(source.clone()), progress).await;
 
     if should_retire_circ(&r) {
-        retire_circ(&circ_mgr, &source, "Partial response");
+        retire_circ(circ_mgr, &source, "Partial response");
     }
 
     r
@@ -166,6 +290,76 @@ where
     S: AsyncRead + AsyncWrite + Send + Unpin,
     SP: SleepProvider,
 {
+    download_counting(runtime, req, stream, source, None).await
+}
+
+/// As [`download`], but if `progress` is provided, add the length of each
+/// received body chunk to it as the chunk arrives.
+///
+/// (This is how [`get_resource_hedged`] observes whether a request is
+/// still making progress.)
+async fn download_counting<R, S, SP>(
+    runtime: &SP,
+    req: &R,
+    stream: &mut S,
+    source: Option<SourceInfo>,
+    progress: Option<&AtomicU64>,
+) -> Result<DirResponse>
+where
+    R: request::Requestable + ?Sized,
+    S: AsyncRead + AsyncWrite + Send + Unpin,
+    SP: SleepProvider,
+{
+    let mut result = Vec::new();
+    let response = download_into(runtime, req, stream, source.clone(), |chunk| {
+        if let Some(progress) = progress {
+            progress.fetch_add(chunk.len() as u64, Ordering::Relaxed);
+        }
+        result.extend_from_slice(chunk);
+        Ok(())
+    })
+    .await?;
+    if response.status_code() != 200 {
+        return Ok(response);
+    }
+    // Re-attach the body that our closure accumulated.
+    Ok(DirResponse::new(
+        200,
+        response.error().cloned(),
+        result,
+        source,
+    ))
+}
+
+/// Fetch a Tor directory object from a provided stream, feeding the
+/// decompressed body incrementally to `consume` as it arrives.
+///
+/// This behaves like [`download`], but instead of buffering the whole
+/// decompressed document (which can run to many megabytes) before anyone
+/// can look at it, each decompressed chunk is handed to `consume` as soon
+/// as it is produced.  This lets a caller overlap its own processing
+/// (hashing, storage, splitting at document boundaries for parsing) with
+/// the network transfer and decompression, and caps this function's own
+/// memory use at one chunk.
+///
+/// The returned `DirResponse` has an empty body; `consume` has seen the
+/// data.  If the transfer fails partway through, `consume` will already
+/// have seen a prefix of the document, and the returned response records
+/// the error just as `download` does for a partial buffered response.
+pub async fn download_into<R, S, SP, F>(
+    runtime: &SP,
+    req: &R,
+    stream: &mut S,
+    source: Option<SourceInfo>,
+    consume: F,
+) -> Result<DirResponse>
+where
+    R: request::Requestable + ?Sized,
+    S: AsyncRead + AsyncWrite + Send + Unpin,
+    SP: SleepProvider,
+    F: FnMut(&[u8]) -> RequestResult<()>,
+{
+    let mut consume = consume;
     let wrap_err = |error| {
         Error::RequestFailed(RequestFailedError {
             source: source.clone(),
@@ -193,7 +387,6 @@ where
     let mut buffered = BufReader::new(stream);
 
     // Handle the response
-    // TODO: should there be a separate timeout here?
     let header = read_headers(&mut buffered).await.map_err(wrap_err)?;
     if header.status != Some(200) {
         return Ok(DirResponse::new(
@@ -206,12 +399,17 @@ where
 
     let mut decoder = get_decoder(buffered, header.encoding.as_deref()).map_err(wrap_err)?;
 
-    let mut result = Vec::new();
-    let ok = read_and_decompress(runtime, &mut decoder, maxlen, &mut result).await;
-
-    let ok = match (partial_ok, ok, result.len()) {
-        (true, Err(e), n) if n > 0 => {
-            // Note that we _don't_ return here: we want the partial response.
+    let mut got_any = false;
+    let ok = read_and_decompress_into(runtime, &mut decoder, maxlen, |chunk| {
+        got_any = true;
+        consume(chunk)
+    })
+    .await;
+
+    let ok = match (partial_ok, ok, got_any) {
+        (true, Err(e), true) => {
+            // The consumer has a partial document, and the caller said
+            // that's useful: report the error alongside a 200 response.
             Err(e)
         }
         (_, Err(e), _) => {
@@ -220,7 +418,7 @@ where
         (_, Ok(()), _) => Ok(()),
     };
 
-    Ok(DirResponse::new(200, ok.err(), result, source))
+    Ok(DirResponse::new(200, ok.err(), vec![], source))
 }
 
 /// Read and parse HTTP/1 headers from `stream`.
@@ -306,9 +504,13 @@ struct HeaderStatus {
 /// Returns the status of our download attempt, stores any data that
 /// we were able to download into `result`.  Existing contents of
 /// `result` are overwritten.
+///
+/// (Only tests use this convenience wrapper now; production callers go
+/// through `read_and_decompress_into`.)
+#[cfg(test)]
 async fn read_and_decompress<S, SP>(
     runtime: &SP,
-    mut stream: S,
+    stream: S,
     maxlen: usize,
     result: &mut Vec<u8>,
 ) -> RequestResult<()>
@@ -316,7 +518,35 @@ where
     S: AsyncRead + Unpin,
     SP: SleepProvider,
 {
-    let buffer_window_size = 1024;
+    result.clear();
+    read_and_decompress_into(runtime, stream, maxlen, |chunk| {
+        result.extend_from_slice(chunk);
+        Ok(())
+    })
+    .await
+}
+
+/// Helper: download directory information from `stream`, decompress it,
+/// and feed each decompressed chunk to `consume` as it is produced.
+///
+/// If we get more than `maxlen` bytes after decompression, give an error;
+/// `consume` never sees bytes past that limit.  If `consume` returns an
+/// error, stop and return it.
+async fn read_and_decompress_into<S, SP, F>(
+    runtime: &SP,
+    mut stream: S,
+    maxlen: usize,
+    mut consume: F,
+) -> RequestResult<()>
+where
+    S: AsyncRead + Unpin,
+    SP: SleepProvider,
+    F: FnMut(&[u8]) -> RequestResult<()>,
+{
+    /// Size of our scratch buffer: how much we try to read (and hand to
+    /// `consume`) at a time.
+    const BUFFER_WINDOW_SIZE: usize = 1024;
+    let mut buf = [0_u8; BUFFER_WINDOW_SIZE];
     let mut written_total: usize = 0;
     // TODO(nickm): This should be an option, and is maybe too long.
     // Though for some users it may be too short?
@@ -325,38 +555,22 @@ where
     futures::pin_mut!(timer);
 
     loop {
-        // allocate buffer for next read
-        result.resize(written_total + buffer_window_size, 0);
-        let buf: &mut [u8] = &mut result[written_total..written_total + buffer_window_size];
-
         let status = futures::select! {
-            status = stream.read(buf).fuse() => status,
+            status = stream.read(&mut buf[..]).fuse() => status,
             _ = timer => {
-                result.resize(written_total, 0); // truncate as needed
                 return Err(RequestError::DirTimeout);
             }
         };
         let written_in_this_loop = match status {
             Ok(n) => n,
             Err(other) => {
-                result.resize(written_total, 0); // truncate as needed
                 return Err(other.into());
             }
         };
 
-        written_total += written_in_this_loop;
-
         // exit conditions below
 
         if written_in_this_loop == 0 {
-            /*
-            in case we read less than `buffer_window_size` in last `read`
-            we need to shrink result because otherwise we'll return those
-            un-read 0s
-            */
-            if written_total < result.len() {
-                result.resize(written_total, 0);
-            }
             return Ok(());
         }
 
@@ -365,10 +579,17 @@ where
         // would in turn require some tricky programming.  For now, we
         // use the maximum length here to prevent an attacker from
         // filling our RAM.
-        if written_total > maxlen {
-            result.resize(maxlen, 0);
-            return Err(RequestError::ResponseTooLong(written_total));
+        if written_total + written_in_this_loop > maxlen {
+            // Pass along only the part that fits, so that the consumer's
+            // view agrees with the buffered version's truncation.
+            consume(&buf[..maxlen - written_total])?;
+            return Err(RequestError::ResponseTooLong(
+                written_total + written_in_this_loop,
+            ));
         }
+
+        consume(&buf[..written_in_this_loop])?;
+        written_total += written_in_this_loop;
     }
 }
 
@@ -725,6 +946,57 @@ mod test {
         Ok(())
     }
 
+    #[test]
+    fn test_download_into() {
+        // As test_download, but stream the body through a chunk consumer.
+        let req: request::MicrodescRequest = vec![[9; 32]].into_iter().collect();
+
+        let (mut s1, s2) = stream_pair();
+        let (mut s2_r, mut s2_w) = s2.split();
+
+        tor_rtcompat::test_with_one_runtime!(|rt| async move {
+            let mut collected = Vec::new();
+            let (response, _request, _send): (
+                Result<DirResponse>,
+                RequestResult<Vec<u8>>,
+                RequestResult<()>,
+            ) = futures::join!(
+                async {
+                    let r = download_into(&rt, &req, &mut s1, None, |chunk| {
+                        collected.extend_from_slice(chunk);
+                        Ok(())
+                    })
+                    .await;
+                    s1.close().await.map_err(|error| {
+                        Error::RequestFailed(RequestFailedError {
+                            source: None,
+                            error: error.into(),
+                        })
+                    })?;
+                    r
+                },
+                async {
+                    let mut v = Vec::new();
+                    s2_r.read_to_end(&mut v).await?;
+                    Ok(v)
+                },
+                async {
+                    s2_w.write_all(b"HTTP/1.0 200 OK\r\n\r\nThis is where the descs would go.")
+                        .await?;
+                    s2_w.close().await?;
+                    Ok(())
+                }
+            );
+
+            let response = response.unwrap();
+            assert_eq!(response.status_code(), 200);
+            assert!(response.error().is_none());
+            // The body went to the consumer, not the response.
+            assert!(response.output_unchecked().is_empty());
+            assert_eq!(&collected[..], b"This is where the descs would go.");
+        });
+    }
+
     #[test]
     fn test_download_truncated() {
         // Request only one md, so "partial ok" will not be set.
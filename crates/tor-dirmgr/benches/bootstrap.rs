@@ -0,0 +1,122 @@
+//! Benchmarks for the directory bootstrap pipeline, over canned data.
+//!
+//! Run with `cargo bench -p tor-dirmgr --features testing`.
+//!
+//! These drive the real bootstrap state machine (consensus parsing and
+//! validation, certificate checking, and microdescriptor loading) with no
+//! network involved, so "time to usable directory" can be tracked in CI
+//! without depending on the live network's mood.
+
+use criterion::{criterion_group, criterion_main, Criterion};
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::SystemTime;
+
+use time::macros::datetime;
+use tor_dirmgr::bench_utils::{fill_microdescs, validate_consensus};
+
+/// Consensus signed by the test authorities below.
+const CONSENSUS: &str = include_str!("../testdata/mdconsensus1.txt");
+/// Authority certificates for CONSENSUS.
+const CERTS: [&str; 2] = [
+    include_str!("../testdata/cert-5696.txt"),
+    include_str!("../testdata/cert-5A23.txt"),
+];
+/// The authorities we trust for CONSENSUS.
+const AUTHORITY_IDS: [&str; 2] = [
+    "5696AB38CB3852AFA476A5C07B2D4788963D5567",
+    "5A23BA701776C9C1AB1C06E734E92AB3D5350D64",
+];
+
+/// A consensus that matches the microdescriptors in MICRODESCS.
+const CONSENSUS2: &str = include_str!("../testdata/mdconsensus2.txt");
+/// Microdescriptors for every relay in CONSENSUS2.
+const MICRODESCS: &str = include_str!("../testdata/microdescs.txt");
+
+/// A time within CONSENSUS's validity interval.
+fn consensus1_time() -> SystemTime {
+    datetime!(2020-08-07 12:42:45 UTC).into()
+}
+
+/// A time within CONSENSUS2's validity interval.
+fn consensus2_time() -> SystemTime {
+    datetime!(2021-10-27 21:26:45 UTC).into()
+}
+
+/// A global allocator wrapper that counts allocations, so that the
+/// per-pass allocation counts can be reported alongside wall-clock time.
+struct CountingAlloc;
+
+/// Number of heap allocations made so far.
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+// SAFETY: delegates entirely to the system allocator.
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
+
+/// Run `f` once and report how many heap allocations it made.
+fn report_allocations<F: FnOnce()>(label: &str, f: F) {
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    f();
+    let after = ALLOCATIONS.load(Ordering::Relaxed);
+    println!("{}: {} allocations per pass", label, after - before);
+}
+
+fn bootstrap_benchmarks(c: &mut Criterion) {
+    let rt = tor_rtcompat::PreferredRuntime::create().expect("no runtime");
+
+    // One-shot allocation counts, before the timed runs.
+    report_allocations("validate_consensus", || {
+        assert!(validate_consensus(
+            &rt,
+            CONSENSUS,
+            &CERTS,
+            &AUTHORITY_IDS,
+            consensus1_time()
+        ));
+    });
+    report_allocations("fill_microdescs", || {
+        assert!(fill_microdescs(
+            &rt,
+            CONSENSUS2,
+            MICRODESCS,
+            consensus2_time()
+        ));
+    });
+
+    c.bench_function("bootstrap_validate_consensus", |b| {
+        b.iter(|| {
+            assert!(validate_consensus(
+                &rt,
+                CONSENSUS,
+                &CERTS,
+                &AUTHORITY_IDS,
+                consensus1_time()
+            ));
+        });
+    });
+
+    c.bench_function("bootstrap_fill_microdescs", |b| {
+        b.iter(|| {
+            assert!(fill_microdescs(
+                &rt,
+                CONSENSUS2,
+                MICRODESCS,
+                consensus2_time()
+            ));
+        });
+    });
+}
+
+criterion_group!(bootstrap, bootstrap_benchmarks);
+criterion_main!(bootstrap);
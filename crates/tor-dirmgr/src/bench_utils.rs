@@ -0,0 +1,167 @@
+//! Support for benchmarking the directory bootstrap state machine.
+//!
+//! This module is only built when the `testing` feature is enabled, and
+//! nothing in it is covered by semver guarantees: it exists so that the
+//! `benches/` harness can drive the crate-private bootstrap states over
+//! canned directory data, with no live network involved.
+
+use std::sync::Arc;
+use std::time::SystemTime;
+
+use tor_checkable::{ExternallySigned, Timebound};
+use tor_netdoc::doc::microdesc::MicrodescReader;
+use tor_netdoc::doc::netstatus::MdConsensus;
+use tor_netdoc::AllowAnnotations;
+use tor_rtcompat::Runtime;
+use tor_rtmock::time::MockSleepProvider;
+use tor_rtcompat::CompoundRuntime;
+
+use crate::authority::Authority;
+use crate::docid::{CacheUsage, ClientRequest};
+use crate::docmeta::ConsensusMeta;
+use crate::state::{DirState, GetConsensusState, GetMicrodescsState};
+use crate::{DirMgrConfig, DocId, DocSource};
+use tor_llcrypto::pk::rsa::RsaIdentity;
+
+/// Return a runtime whose wallclock reports `now`, for use with canned
+/// documents whose validity interval is in the past.
+fn time_shifted_runtime<R: Runtime>(now: SystemTime, rt: &R) -> impl Runtime {
+    let msp = MockSleepProvider::new(now);
+    CompoundRuntime::new(rt.clone(), msp, rt.clone(), rt.clone(), rt.clone())
+}
+
+/// Return a configuration that trusts the authorities with the given
+/// (hex-encoded) v3 identity fingerprints.
+fn config_with_authorities(authority_ids: &[&str]) -> Arc<DirMgrConfig> {
+    let mut netcfg = crate::NetworkConfig::builder();
+    netcfg.set_fallback_caches(vec![]);
+    netcfg.set_authorities(
+        authority_ids
+            .iter()
+            .map(|id| {
+                Authority::builder()
+                    .name("bench")
+                    .v3ident(RsaIdentity::from_hex(id).expect("bad authority fingerprint"))
+                    .clone()
+            })
+            .collect(),
+    );
+    let cfg = DirMgrConfig {
+        cache_path: "/we_will_never_use_this/".into(),
+        network: netcfg.build().expect("invalid network config"),
+        ..Default::default()
+    };
+    Arc::new(cfg)
+}
+
+/// Drive the bootstrap state machine from a downloaded consensus through
+/// certificate fetching to a fully validated consensus.
+///
+/// `authority_ids` are the hex fingerprints of the authorities to trust,
+/// and `valid_at` must fall within the consensus's validity interval.
+/// Panics if any step fails; returns true once the consensus has been
+/// validated.
+pub fn validate_consensus<R: Runtime>(
+    rt: &R,
+    consensus: &str,
+    certs: &[&str],
+    authority_ids: &[&str],
+    valid_at: SystemTime,
+) -> bool {
+    let rt = time_shifted_runtime(valid_at, rt);
+    let cfg = config_with_authorities(authority_ids);
+
+    let mut state = GetConsensusState::new(
+        rt,
+        cfg,
+        CacheUsage::CacheOkay,
+        None,
+        #[cfg(feature = "dirfilter")]
+        Arc::new(crate::filter::NilFilter),
+    );
+    let source = DocSource::DirServer { source: None };
+    let req = tor_dirclient::request::ConsensusRequest::new(
+        tor_netdoc::doc::netstatus::ConsensusFlavor::Microdesc,
+    );
+    let req = ClientRequest::Consensus(req);
+    let mut changed = false;
+    state
+        .add_from_download(consensus, &req, source.clone(), None, &mut changed)
+        .expect("failed to add consensus");
+
+    let mut state: Box<dyn DirState> = Box::new(state).advance();
+    for cert in certs {
+        // Ask for exactly what the state machine says is missing, as the
+        // downloader would.
+        let mut req = tor_dirclient::request::AuthCertRequest::new();
+        for missing in state.missing_docs() {
+            if let DocId::AuthCert(ids) = missing {
+                req.push(ids);
+            }
+        }
+        let req = ClientRequest::AuthCert(req);
+        let mut changed = false;
+        state
+            .add_from_download(cert, &req, source.clone(), None, &mut changed)
+            .expect("failed to add certificate");
+    }
+    state.can_advance()
+}
+
+/// Drive the bootstrap state machine from a validated consensus through
+/// microdescriptor loading.
+///
+/// (The consensus's signatures are assumed, not checked, here: this
+/// exercises the microdescriptor half of the pipeline.)  Returns true
+/// once a usable NetDir has been produced.
+pub fn fill_microdescs<R: Runtime>(
+    rt: &R,
+    consensus: &str,
+    microdescs: &str,
+    valid_at: SystemTime,
+) -> bool {
+    let rt = time_shifted_runtime(valid_at, rt);
+    let cfg = config_with_authorities(&[]);
+
+    let (signed, rest, parsed) = MdConsensus::parse(consensus).expect("bad consensus");
+    let consensus = parsed
+        .dangerously_assume_timely()
+        .dangerously_assume_wellsigned();
+    let meta = ConsensusMeta::from_consensus(signed, rest, &consensus);
+    let mut state = GetMicrodescsState::new(
+        CacheUsage::CacheOkay,
+        consensus,
+        meta,
+        rt,
+        cfg,
+        None,
+        #[cfg(feature = "dirfilter")]
+        Arc::new(crate::filter::NilFilter),
+    );
+
+    // Feed the microdescriptors in as if they had come from the cache.
+    let docs = MicrodescReader::new(microdescs, &AllowAnnotations::AnnotationsNotAllowed)
+        .map(|anno| {
+            let anno = anno.expect("bad microdesc");
+            let text = anno.within(microdescs).expect("microdesc not in text");
+            let md = anno.into_microdesc();
+            (
+                DocId::Microdesc(*md.digest()),
+                crate::storage::InputString::from(text.to_owned()).into(),
+            )
+        })
+        .collect();
+    let mut changed = false;
+    state
+        .add_from_cache(docs, None, &mut changed)
+        .expect("failed to add microdescs");
+
+    // Success means the state machine has a complete NetDir ready to
+    // install.
+    match state.get_netdir_change() {
+        Some(crate::state::NetDirChange::AttemptReplace { netdir, .. }) => {
+            netdir.take().is_some()
+        }
+        _ => false,
+    }
+}
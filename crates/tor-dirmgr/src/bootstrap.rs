@@ -35,6 +35,15 @@ use tor_circmgr::{CircMgr, DirInfo};
 use tor_netdir::{NetDir, NetDirProvider as _};
 use tor_netdoc::doc::netstatus::ConsensusFlavor;
 
+/// Largest number of documents that [`load_once`] will load from the cache
+/// and hand to the state machine in a single batch.
+///
+/// This bounds the peak heap needed to reload a directory from the cache:
+/// the text of each batch is parsed and dropped before the next batch is
+/// loaded.  (Consensus documents are memory-mapped, not loaded; this limit
+/// mostly matters for microdescriptors.)
+const DOCS_PER_LOAD_CHUNK: usize = 512;
+
 /// Given a Result<()>, exit the current function if it is anything other than
 /// Ok(), or a nonfatal error.
 macro_rules! propagate_fatal_errors {
@@ -75,6 +84,7 @@ impl AttemptId {
         static NEXT: AtomicUsize = AtomicUsize::new(1);
         let id = NEXT.fetch_add(1, Ordering::Relaxed);
         let id = id.try_into().expect("Allocated too many AttemptIds");
+        crate::metrics::note_bootstrap_started();
         Self { id }
     }
 }
@@ -247,18 +257,36 @@ pub(crate) fn make_requests_for_documents<R: Runtime>(
 }
 
 /// Launch a single client request and get an associated response.
+///
+/// If `hedge_delay` is set, a request that makes no progress for that long
+/// is raced against a duplicate request to another cache.
 async fn fetch_single<R: Runtime>(
     rt: &R,
     request: ClientRequest,
     current_netdir: Option<&NetDir>,
     circmgr: Arc<CircMgr<R>>,
+    hedge_delay: Option<Duration>,
 ) -> Result<(ClientRequest, DirResponse)> {
     let dirinfo: DirInfo = match current_netdir {
         Some(netdir) => netdir.into(),
         None => tor_circmgr::DirInfo::Nothing,
     };
-    let outcome =
-        tor_dirclient::get_resource(request.as_requestable(), dirinfo, rt, circmgr.clone()).await;
+    let outcome = match hedge_delay {
+        Some(delay) => {
+            tor_dirclient::get_resource_hedged(
+                request.as_requestable(),
+                dirinfo,
+                rt,
+                circmgr.clone(),
+                delay,
+            )
+            .await
+        }
+        None => {
+            tor_dirclient::get_resource(request.as_requestable(), dirinfo, rt, circmgr.clone())
+                .await
+        }
+    };
 
     note_request_outcome(&circmgr, &outcome);
 
@@ -282,6 +310,7 @@ async fn fetch_multiple<R: Runtime>(
     dirmgr: Arc<DirMgr<R>>,
     missing: &[DocId],
     parallelism: usize,
+    hedge_delay: Option<Duration>,
 ) -> Result<Vec<(ClientRequest, DirResponse)>> {
     let requests = {
         let store = dirmgr.store.lock().expect("store lock poisoned");
@@ -306,7 +335,15 @@ async fn fetch_multiple<R: Runtime>(
     // TODO: instead of waiting for all the queries to finish, we
     // could stream the responses back or something.
     let responses: Vec<Result<(ClientRequest, DirResponse)>> = futures::stream::iter(requests)
-        .map(|query| fetch_single(&dirmgr.runtime, query, netdir.as_deref(), circmgr.clone()))
+        .map(|query| {
+            fetch_single(
+                &dirmgr.runtime,
+                query,
+                netdir.as_deref(),
+                circmgr.clone(),
+                hedge_delay,
+            )
+        })
         .buffer_unordered(parallelism)
         .collect()
         .await;
@@ -350,12 +387,25 @@ async fn load_once<R: Runtime>(
             missing.len()
         );
 
-        let documents = {
-            let store = dirmgr.store.lock().expect("store lock poisoned");
-            load_documents_from_store(&missing, &**store)?
-        };
+        // Load the missing documents in bounded chunks, so that we never
+        // materialize the text of every document at once.  (On a cold start
+        // with a full cache, the missing list is mostly thousands of
+        // microdescriptors; loading them all before parsing any costs
+        // several megabytes of peak heap for no benefit.)  Each chunk's
+        // text is dropped before the next chunk is loaded.
+        let mut result = Ok(());
+        for chunk in missing.chunks(DOCS_PER_LOAD_CHUNK) {
+            let documents = {
+                let store = dirmgr.store.lock().expect("store lock poisoned");
+                load_documents_from_store(chunk, &**store)?
+            };
 
-        state.add_from_cache(documents, &mut changed)
+            result = state.add_from_cache(documents, Some(&dirmgr.store), &mut changed);
+            if result.is_err() {
+                break;
+            }
+        }
+        result
     };
 
     // We have to update the status here regardless of the outcome, if we got
@@ -428,10 +478,11 @@ async fn download_attempt<R: Runtime>(
     dirmgr: &Arc<DirMgr<R>>,
     state: &mut Box<dyn DirState>,
     parallelism: usize,
+    hedge_delay: Option<Duration>,
     attempt_id: AttemptId,
 ) -> Result<()> {
     let missing = state.missing_docs();
-    let fetched = fetch_multiple(Arc::clone(dirmgr), &missing, parallelism).await?;
+    let fetched = fetch_multiple(Arc::clone(dirmgr), &missing, parallelism, hedge_delay).await?;
     let mut n_errors = 0;
     for (client_req, dir_response) in fetched {
         let source = dir_response.source().map(Clone::clone);
@@ -591,7 +642,7 @@ pub(crate) async fn download<R: Runtime>(
             now = {
                 let dirmgr = upgrade_weak_ref(&dirmgr)?;
                 futures::select_biased! {
-                    outcome = download_attempt(&dirmgr, state, parallelism.into(), attempt_id).fuse() => {
+                    outcome = download_attempt(&dirmgr, state, parallelism.into(), retry_config.hedge_delay(), attempt_id).fuse() => {
                         if let Err(e) = outcome {
                             warn!("Error while downloading: {}", e);
                             propagate_fatal_errors!(Err(e));
@@ -783,6 +834,7 @@ mod test {
         fn add_from_cache(
             &mut self,
             docs: HashMap<DocId, DocumentText>,
+            _storage: Option<&Mutex<DynStore>>,
             changed: &mut bool,
         ) -> Result<()> {
             for id in docs.keys() {
@@ -211,7 +211,7 @@ impl DirTolerance {
 //
 // If it grows a field, arti-client ought not to compile any more.
 #[derive(Debug, Clone)]
-#[cfg_attr(test, derive(Default))]
+#[cfg_attr(any(test, feature = "testing"), derive(Default))]
 #[allow(clippy::exhaustive_structs)]
 pub struct DirMgrConfig {
     /// Location to use for storing and reading current-format
@@ -43,12 +43,15 @@
 #![allow(clippy::single_component_path_imports)]
 
 pub mod authority;
+#[cfg(feature = "testing")]
+pub mod bench_utils;
 mod bootstrap;
 pub mod config;
 mod docid;
 mod docmeta;
 mod err;
 mod event;
+pub mod metrics;
 mod retry;
 mod shared_ref;
 mod state;
@@ -987,8 +990,14 @@ impl<R: Runtime> DirMgr<R> {
                             &text,
                             Some(*meta.sha3_256_of_signed()),
                         )?;
-                        new_consensus.check_digest()?;
-                        return Ok(new_consensus.to_string());
+                        // Emit the patched document in one pass, hashing it
+                        // as it is produced rather than materializing it
+                        // twice.  (The unchanged regions are borrowed from
+                        // the stored old consensus.)
+                        let mut buf = Vec::with_capacity(new_consensus.byte_len());
+                        new_consensus.write_and_check_digest(&mut buf)?;
+                        return String::from_utf8(buf)
+                            .map_err(|_| tor_error::internal!("diff of UTF-8 documents was not UTF-8").into());
                     }
                 }
                 return Err(Error::Unwanted(
@@ -1047,6 +1056,7 @@ impl<R: Runtime> DirMgr<R> {
                     self.events.publish(DirEvent::NewDescriptors);
 
                     info!("Marked consensus usable.");
+                    crate::metrics::note_directory_usable();
                     store.mark_consensus_usable(consensus_meta)?;
                     // Now that a consensus is usable, older consensuses may
                     // need to expire.
@@ -0,0 +1,67 @@
+//! Cheap global counters for instrumenting directory bootstrapping.
+//!
+//! These are relaxed atomics (no locks, no formatting), cheap enough to
+//! leave enabled in production; an application can surface them to an
+//! operator, e.g. over a metrics endpoint.
+
+use once_cell::sync::Lazy;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Instant;
+
+/// A per-process epoch, used to store instants as plain milliseconds.
+static EPOCH: Lazy<Instant> = Lazy::new(Instant::now);
+
+/// Sentinel meaning "never happened" in the timestamp cells below.
+const NEVER: u64 = 0;
+
+/// When (in ms since `EPOCH`, plus 1) the current bootstrap attempt began.
+static BOOTSTRAP_STARTED_AT: AtomicU64 = AtomicU64::new(NEVER);
+/// When (in ms since `EPOCH`, plus 1) we last marked a directory usable.
+static BOOTSTRAP_USABLE_AT: AtomicU64 = AtomicU64::new(NEVER);
+/// Number of bootstrap attempts begun.
+static BOOTSTRAP_ATTEMPTS: AtomicU64 = AtomicU64::new(0);
+
+/// Return the current time, in milliseconds since `EPOCH`, plus 1.
+///
+/// (The "plus 1" keeps 0 free as the "never" sentinel.)
+fn now_ms() -> u64 {
+    u64::try_from(EPOCH.elapsed().as_millis()).unwrap_or(u64::MAX - 1) + 1
+}
+
+/// Note that a new bootstrap attempt has begun.
+pub(crate) fn note_bootstrap_started() {
+    BOOTSTRAP_ATTEMPTS.fetch_add(1, Ordering::Relaxed);
+    BOOTSTRAP_STARTED_AT.store(now_ms(), Ordering::Relaxed);
+}
+
+/// Note that we have marked a directory as usable.
+pub(crate) fn note_directory_usable() {
+    BOOTSTRAP_USABLE_AT.store(now_ms(), Ordering::Relaxed);
+}
+
+/// A snapshot of the bootstrap counters maintained by this crate.
+#[derive(Debug, Clone, Default)]
+#[non_exhaustive]
+pub struct DirMgrMetrics {
+    /// Number of bootstrap attempts begun.
+    pub bootstrap_attempts: u64,
+    /// How long the most recent successful bootstrap took, in
+    /// milliseconds, if we have completed one since the last attempt
+    /// began.
+    pub last_bootstrap_ms: Option<u64>,
+}
+
+/// Return a snapshot of this crate's bootstrap counters.
+pub fn metrics() -> DirMgrMetrics {
+    let started = BOOTSTRAP_STARTED_AT.load(Ordering::Relaxed);
+    let usable = BOOTSTRAP_USABLE_AT.load(Ordering::Relaxed);
+    let last_bootstrap_ms = if started != NEVER && usable >= started {
+        Some(usable - started)
+    } else {
+        None
+    };
+    DirMgrMetrics {
+        bootstrap_attempts: BOOTSTRAP_ATTEMPTS.load(Ordering::Relaxed),
+        last_bootstrap_ms,
+    }
+}
@@ -43,6 +43,13 @@ pub struct DownloadSchedule {
         )
     )]
     parallelism: NonZeroU8,
+
+    /// How long to wait for a request to make progress before launching a
+    /// duplicate ("hedged") request to another cache, taking whichever
+    /// finishes first.  Zero disables hedging.
+    #[builder(default = "Duration::from_millis(3000)")]
+    #[builder_field_attr(serde(default, with = "humantime_serde::option"))]
+    hedge_delay: Duration,
 }
 
 impl_standard_builder! { DownloadSchedule }
@@ -109,6 +116,17 @@ impl DownloadSchedule {
     pub fn schedule(&self) -> RetryDelay {
         RetryDelay::from_duration(self.initial_delay)
     }
+
+    /// Return the delay after which a request with no response should be
+    /// hedged with a duplicate request to another cache, or None if
+    /// hedging is disabled.
+    pub fn hedge_delay(&self) -> Option<Duration> {
+        if self.hedge_delay.is_zero() {
+            None
+        } else {
+            Some(self.hedge_delay)
+        }
+    }
 }
 
 #[cfg(test)]
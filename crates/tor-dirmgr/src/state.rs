@@ -21,7 +21,7 @@ use tor_error::internal;
 use tor_netdir::{MdReceiver, NetDir, PartialNetDir};
 use tor_netdoc::doc::authcert::UncheckedAuthCert;
 use tor_netdoc::doc::netstatus::Lifetime;
-use tracing::{info, warn};
+use tracing::{debug, info, warn};
 
 use crate::event::DirProgress;
 
@@ -108,6 +108,10 @@ pub(crate) trait DirState: Send {
     /// Add one or more documents from our cache; returns 'true' if there
     /// was any change in this state.
     ///
+    /// If `storage` is provided, it is the cache the documents came from;
+    /// states may consult it to learn what a previous run already
+    /// validated.
+    ///
     /// Set `changed` to true if any semantic changes in this state were made.
     ///
     /// An error return does not necessarily mean that no data was added;
@@ -115,6 +119,7 @@ pub(crate) trait DirState: Send {
     fn add_from_cache(
         &mut self,
         docs: HashMap<DocId, DocumentText>,
+        storage: Option<&Mutex<DynStore>>,
         changed: &mut bool,
     ) -> Result<()>;
 
@@ -278,6 +283,7 @@ impl<R: Runtime> DirState for GetConsensusState<R> {
     fn add_from_cache(
         &mut self,
         docs: HashMap<DocId, DocumentText>,
+        storage: Option<&Mutex<DynStore>>,
         changed: &mut bool,
     ) -> Result<()> {
         let text = match docs.into_iter().next() {
@@ -294,10 +300,22 @@ impl<R: Runtime> DirState for GetConsensusState<R> {
 
         let source = DocSource::LocalCache;
 
+        // Find the digest of the consensus (if any) that a previous run
+        // already validated and marked usable, so that we can skip
+        // re-checking its signatures if this is the same document.
+        let prevalidated = storage.and_then(|s| {
+            let store = s.lock().ok()?;
+            let meta = store
+                .latest_consensus_meta(ConsensusFlavor::Microdesc)
+                .ok()??;
+            Some(*meta.sha3_256_of_signed())
+        });
+
         self.add_consensus_text(
             source,
             text.as_str().map_err(Error::BadUtf8InCache)?,
             None,
+            prevalidated,
             changed,
         )?;
         Ok(())
@@ -314,7 +332,7 @@ impl<R: Runtime> DirState for GetConsensusState<R> {
             ClientRequest::Consensus(r) => r.last_consensus_date(),
             _ => None,
         };
-        let meta = self.add_consensus_text(source, text, requested_newer_than, changed)?;
+        let meta = self.add_consensus_text(source, text, requested_newer_than, None, changed)?;
 
         if let Some(store) = storage {
             let mut w = store.lock().expect("Directory storage lock poisoned");
@@ -344,12 +362,18 @@ impl<R: Runtime> GetConsensusState<R> {
     /// If `cutoff` is provided, treat any consensus older than `cutoff` as
     /// older-than-requested.
     ///
+    /// If `prevalidated` is provided, it is the digest-of-signed-part of a
+    /// consensus that a previous run fully validated and marked usable in
+    /// our own cache: if `text` has that digest, we skip re-checking its
+    /// signatures.
+    ///
     /// Errors from this method are not fatal to the download process.
     fn add_consensus_text(
         &mut self,
         source: DocSource,
         text: &str,
         cutoff: Option<SystemTime>,
+        prevalidated: Option<[u8; 32]>,
         changed: &mut bool,
     ) -> Result<&ConsensusMeta> {
         // Try to parse it and get its metadata.
@@ -390,12 +414,27 @@ impl<R: Runtime> GetConsensusState<R> {
             .filter(|m| self.recognizes_authority(&m.id_fingerprint))
             .collect();
 
+        // If this is the exact consensus that an earlier run validated and
+        // used (we know, because its digest matches the one recorded in
+        // our own cache when it was marked usable), don't re-verify its
+        // signatures: go straight to fetching microdescriptors.
+        let (consensus, missing_certs) =
+            if prevalidated == Some(*consensus_meta.sha3_256_of_signed()) {
+                debug!("Consensus was validated by an earlier run; skipping signature checks.");
+                (
+                    GetCertsConsensus::Validated(unvalidated.dangerously_assume_wellsigned()),
+                    HashSet::new(),
+                )
+            } else {
+                (GetCertsConsensus::Unvalidated(unvalidated), desired_certs)
+            };
+
         self.next = Some(GetCertsState {
             cache_usage: self.cache_usage,
             consensus_source: source,
-            consensus: GetCertsConsensus::Unvalidated(unvalidated),
+            consensus,
             consensus_meta,
-            missing_certs: desired_certs,
+            missing_certs,
             certs: Vec::new(),
             rt: self.rt.clone(),
             config: self.config.clone(),
@@ -579,6 +618,7 @@ impl<R: Runtime> DirState for GetCertsState<R> {
     fn add_from_cache(
         &mut self,
         docs: HashMap<DocId, DocumentText>,
+        _storage: Option<&Mutex<DynStore>>,
         changed: &mut bool,
     ) -> Result<()> {
         // Here we iterate over the documents we want, taking them from
@@ -724,7 +764,7 @@ impl<R: Runtime> DirState for GetCertsState<R> {
 
 /// Final state: we're fetching or loading microdescriptors
 #[derive(Debug, Clone)]
-struct GetMicrodescsState<R: Runtime> {
+pub(crate) struct GetMicrodescsState<R: Runtime> {
     /// How should we get the consensus from the cache, if at all?
     cache_usage: CacheUsage,
     /// Total number of microdescriptors listed in the consensus.
@@ -880,7 +920,7 @@ impl PendingNetDir {
 impl<R: Runtime> GetMicrodescsState<R> {
     /// Create a new [`GetMicrodescsState`] from a provided
     /// microdescriptor consensus.
-    fn new(
+    pub(crate) fn new(
         cache_usage: CacheUsage,
         consensus: MdConsensus,
         meta: ConsensusMeta,
@@ -936,6 +976,201 @@ impl<R: Runtime> GetMicrodescsState<R> {
     }
 }
 
+/// Minimum body length, in bytes, before [`parse_mds`] will consider
+/// spawning worker threads to parse a microdescriptor download.
+const MIN_PARALLEL_MD_PARSE_LEN: usize = 16 * 1024;
+
+/// Largest number of worker threads that [`parse_mds`] will use to parse a
+/// microdescriptor download.
+const MAX_PARALLEL_MD_PARSE_THREADS: usize = 8;
+
+/// Split `text` — a concatenation of microdescriptors, with no annotations —
+/// into at most `n_chunks` contiguous pieces, each beginning at a
+/// microdescriptor boundary.
+fn split_microdesc_text(text: &str, n_chunks: usize) -> Vec<&str> {
+    // Every microdescriptor begins with an "onion-key" item, and no other
+    // line in a microdescriptor begins with that keyword, so a line
+    // starting with "onion-key" is a document boundary.
+    /// Return the position of `needle` within `haystack`, searching no
+    /// earlier than `start`.
+    ///
+    /// (This searches bytewise, so that an arbitrary `start` is safe even
+    /// when `haystack` contains multi-byte characters.)
+    fn find_from(haystack: &[u8], needle: &[u8], start: usize) -> Option<usize> {
+        haystack
+            .get(start..)?
+            .windows(needle.len())
+            .position(|w| w == needle)
+            .map(|i| start + i)
+    }
+
+    let target_len = text.len() / n_chunks + 1;
+    let mut chunks = Vec::with_capacity(n_chunks);
+    let mut rest = text;
+    while chunks.len() + 1 < n_chunks && rest.len() > target_len {
+        match find_from(rest.as_bytes(), b"\nonion-key", target_len) {
+            Some(i) => {
+                // Split just after the newline, so the next chunk starts
+                // at the boundary.  (This is an ASCII position, so it is
+                // necessarily a character boundary.)
+                let (head, tail) = rest.split_at(i + 1);
+                chunks.push(head);
+                rest = tail;
+            }
+            None => break,
+        }
+    }
+    if !rest.is_empty() {
+        chunks.push(rest);
+    }
+    chunks
+}
+
+/// Parse the microdescriptors in `chunk`, which must not contain
+/// annotations.
+///
+/// Return every successfully parsed microdescriptor, along with the byte
+/// range of its text within `chunk`, and the first parse error (if any).
+fn parse_md_chunk(
+    chunk: &str,
+) -> (
+    Vec<(std::ops::Range<usize>, Microdesc)>,
+    Option<tor_netdoc::Error>,
+) {
+    let mut mds = Vec::new();
+    let mut first_err = None;
+    for anno in MicrodescReader::new(chunk, &AllowAnnotations::AnnotationsNotAllowed) {
+        let anno = match anno {
+            Err(e) => {
+                first_err.get_or_insert(e);
+                continue;
+            }
+            Ok(a) => a,
+        };
+        let txt = anno
+            .within(chunk)
+            .expect("microdesc not from within text as expected");
+        // `txt` is a subslice of `chunk`, so this cannot underflow.
+        let start = txt.as_ptr() as usize - chunk.as_ptr() as usize;
+        let range = start..start + txt.len();
+        mds.push((range, anno.into_microdesc()));
+    }
+    (mds, first_err)
+}
+
+/// Parse a batch of individually-cached microdescriptor documents.
+///
+/// Large batches (a warm restart reloads the whole directory's worth) are
+/// split across worker threads, like [`parse_mds`]; mismatched or
+/// unparseable documents are logged and skipped.
+fn parse_cached_mds(mut docs: Vec<(MdDigest, DocumentText)>) -> Result<Vec<Microdesc>> {
+    /// Parse the documents in one chunk, sequentially.
+    fn parse_chunk(chunk: Vec<(MdDigest, DocumentText)>) -> Result<Vec<Microdesc>> {
+        let mut mds = Vec::with_capacity(chunk.len());
+        for (digest, text) in chunk {
+            if let Ok(md) = Microdesc::parse(text.as_str().map_err(Error::BadUtf8InCache)?) {
+                if md.digest() == &digest {
+                    mds.push(md);
+                    continue;
+                }
+            }
+            warn!("Found a mismatched microdescriptor in cache; ignoring");
+        }
+        Ok(mds)
+    }
+
+    /// Smallest number of cached documents worth spawning threads for.
+    const MIN_PARALLEL_DOCS: usize = 64;
+
+    let n_threads = std::cmp::min(
+        std::thread::available_parallelism().map_or(1, usize::from),
+        MAX_PARALLEL_MD_PARSE_THREADS,
+    );
+    if n_threads < 2 || docs.len() < MIN_PARALLEL_DOCS {
+        return parse_chunk(docs);
+    }
+
+    // Split the documents into one owned chunk per worker.
+    let chunk_size = docs.len() / n_threads + 1;
+    let mut chunks = Vec::with_capacity(n_threads);
+    while docs.len() > chunk_size {
+        let tail = docs.split_off(chunk_size);
+        chunks.push(std::mem::replace(&mut docs, tail));
+    }
+    chunks.push(docs);
+
+    let mut chunks = chunks.into_iter();
+    // (The first chunk is parsed on this thread.)
+    let first = chunks.next().expect("no chunks after splitting");
+    let workers: Vec<_> = chunks
+        .map(|chunk| std::thread::spawn(move || parse_chunk(chunk)))
+        .collect();
+
+    let mut mds = parse_chunk(first)?;
+    for worker in workers {
+        let worker_mds = match worker.join() {
+            Ok(v) => v?,
+            Err(panic) => std::panic::resume_unwind(panic),
+        };
+        mds.extend(worker_mds);
+    }
+    Ok(mds)
+}
+
+/// Parse all the microdescriptors from a downloaded `text`.
+///
+/// Large downloads are split at microdescriptor boundaries and parsed on a
+/// pool of worker threads, since parsing (mostly decoding each
+/// microdescriptor's keys) takes enough CPU time to matter on the
+/// time-to-first-circuit path.
+///
+/// Return every successfully parsed microdescriptor along with the byte
+/// range of its text within `text`, and the first parse error (if any).
+fn parse_mds(text: &str) -> (Vec<(std::ops::Range<usize>, Microdesc)>, Option<tor_netdoc::Error>) {
+    let n_threads = std::cmp::min(
+        std::thread::available_parallelism().map_or(1, usize::from),
+        MAX_PARALLEL_MD_PARSE_THREADS,
+    );
+    if n_threads < 2 || text.len() < MIN_PARALLEL_MD_PARSE_LEN {
+        return parse_md_chunk(text);
+    }
+
+    let chunks = split_microdesc_text(text, n_threads);
+    // Parse every chunk but the first on a worker thread.  Plain spawned
+    // threads want 'static data, so each worker parses an owned copy of its
+    // chunk; the ranges it reports are equally valid within our borrowed
+    // chunk, which is identical.
+    let workers: Vec<_> = chunks[1..]
+        .iter()
+        .map(|chunk| {
+            let chunk: String = (*chunk).to_owned();
+            std::thread::spawn(move || {
+                let (mds, err) = parse_md_chunk(&chunk);
+                (mds, err)
+            })
+        })
+        .collect();
+    let (mut mds, mut first_err) = parse_md_chunk(chunks[0]);
+
+    let mut chunk_offset = chunks[0].len();
+    for (worker, chunk) in workers.into_iter().zip(&chunks[1..]) {
+        let (worker_mds, worker_err) = match worker.join() {
+            Ok(v) => v,
+            Err(panic) => std::panic::resume_unwind(panic),
+        };
+        mds.extend(
+            worker_mds
+                .into_iter()
+                .map(|(range, md)| (range.start + chunk_offset..range.end + chunk_offset, md)),
+        );
+        if let Some(e) = worker_err {
+            first_err.get_or_insert(e);
+        }
+        chunk_offset += chunk.len();
+    }
+    (mds, first_err)
+}
+
 impl<R: Runtime> DirState for GetMicrodescsState<R> {
     fn describe(&self) -> String {
         format!(
@@ -998,21 +1233,18 @@ impl<R: Runtime> DirState for GetMicrodescsState<R> {
     fn add_from_cache(
         &mut self,
         docs: HashMap<DocId, DocumentText>,
+        _storage: Option<&Mutex<DynStore>>,
         changed: &mut bool,
     ) -> Result<()> {
-        let mut microdescs = Vec::new();
-        for (id, text) in docs {
-            if let DocId::Microdesc(digest) = id {
-                if let Ok(md) = Microdesc::parse(text.as_str().map_err(Error::BadUtf8InCache)?) {
-                    if md.digest() == &digest {
-                        microdescs.push(md);
-                        continue;
-                    }
-                }
-                warn!("Found a mismatched microdescriptor in cache; ignoring");
-            }
-        }
+        let docs: Vec<(MdDigest, DocumentText)> = docs
+            .into_iter()
+            .filter_map(|(id, text)| match id {
+                DocId::Microdesc(digest) => Some((digest, text)),
+                _ => None,
+            })
+            .collect();
 
+        let microdescs = parse_cached_mds(docs)?;
         self.register_microdescs(microdescs, &DocSource::LocalCache, changed);
         Ok(())
     }
@@ -1033,18 +1265,12 @@ impl<R: Runtime> DirState for GetMicrodescsState<R> {
         let mut new_mds = Vec::new();
         let mut nonfatal_err = None;
 
-        for anno in MicrodescReader::new(text, &AllowAnnotations::AnnotationsNotAllowed) {
-            let anno = match anno {
-                Err(e) => {
-                    nonfatal_err.get_or_insert_with(|| Error::from_netdoc(source.clone(), e));
-                    continue;
-                }
-                Ok(a) => a,
-            };
-            let txt = anno
-                .within(text)
-                .expect("microdesc not from within text as expected");
-            let md = anno.into_microdesc();
+        let (parsed, parse_err) = parse_mds(text);
+        if let Some(e) = parse_err {
+            nonfatal_err = Some(Error::from_netdoc(source.clone(), e));
+        }
+        for (range, md) in parsed {
+            let txt = &text[range];
             if !requested.contains(md.digest()) {
                 warn!(
                     "Received microdescriptor from {} we did not ask for: {:?}",
@@ -1202,6 +1428,7 @@ impl DirState for PoisonedState {
     fn add_from_cache(
         &mut self,
         _docs: HashMap<DocId, DocumentText>,
+        _storage: Option<&Mutex<DynStore>>,
         _changed: &mut bool,
     ) -> Result<()> {
         unimplemented!()
@@ -1356,6 +1583,38 @@ mod test {
             sk_fingerprint: rsa("D3C013E0E6C82E246090D1C0798B75FCB7ACF120"),
         }
     }
+    #[test]
+    fn parallel_md_parse() {
+        const MICRODESCS: &str = include_str!("../testdata/microdescs.txt");
+        // Repeat the test data so that it is over the parallel-parse
+        // threshold, and remember the digests we expect, in order.
+        let text: String = MICRODESCS.repeat(32);
+        let expected: Vec<MdDigest> =
+            MicrodescReader::new(&text, &AllowAnnotations::AnnotationsNotAllowed)
+                .map(|anno| *anno.unwrap().md().digest())
+                .collect();
+        assert!(text.len() >= super::MIN_PARALLEL_MD_PARSE_LEN);
+
+        // Chunks must re-concatenate to the input, and each must start at a
+        // microdescriptor boundary.
+        let chunks = super::split_microdesc_text(&text, 4);
+        assert_eq!(chunks.concat(), text);
+        for chunk in &chunks {
+            assert!(chunk.starts_with("onion-key"));
+        }
+
+        // The parallel parse must yield the same descriptors in the same
+        // order, with ranges that reproduce each descriptor's text.
+        let (parsed, err) = super::parse_mds(&text);
+        assert!(err.is_none());
+        let digests: Vec<MdDigest> = parsed.iter().map(|(_, md)| *md.digest()).collect();
+        assert_eq!(digests, expected);
+        for (range, md) in &parsed {
+            let reparsed = Microdesc::parse(&text[range.clone()]).unwrap();
+            assert_eq!(reparsed.digest(), md.digest());
+        }
+    }
+
     fn microdescs() -> HashMap<MdDigest, String> {
         const MICRODESCS: &str = include_str!("../testdata/microdescs.txt");
         let text = MICRODESCS;
@@ -1496,6 +1755,59 @@ mod test {
             );
 
             // Try again, but this time get the state from the cache.
+            let cfg = make_dirmgr_config(Some(test_authorities()));
+            let mut state = GetConsensusState::new(
+                rt.clone(),
+                cfg,
+                CacheUsage::CacheOkay,
+                None,
+                #[cfg(feature = "dirfilter")]
+                Arc::new(crate::filter::NilFilter),
+            );
+            let text: crate::storage::InputString = CONSENSUS.to_owned().into();
+            let map = vec![(docid, text.into())].into_iter().collect();
+            let mut changed = false;
+            let outcome = state.add_from_cache(map, None, &mut changed);
+            assert!(outcome.is_ok());
+            assert!(changed);
+            assert!(state.can_advance());
+            // Without the cache to consult, the consensus still needs its
+            // signatures checked.
+            let next = Box::new(state).advance();
+            assert_eq!(
+                &next.describe(),
+                "Downloading certificates for consensus (we are missing 2/2)."
+            );
+
+            // Now mark the consensus usable in the store, as a previous run
+            // would have after validating it, and load from the cache
+            // again.  This time the signature checks are skipped, and we
+            // can go straight to fetching microdescriptors.
+            let meta = {
+                // (Reconstruct the metadata by re-adding the consensus.)
+                let cfg = make_dirmgr_config(Some(test_authorities()));
+                let mut state = GetConsensusState::new(
+                    rt.clone(),
+                    cfg,
+                    CacheUsage::CacheOkay,
+                    None,
+                    #[cfg(feature = "dirfilter")]
+                    Arc::new(crate::filter::NilFilter),
+                );
+                let mut changed = false;
+                state
+                    .add_consensus_text(
+                        DocSource::LocalCache,
+                        CONSENSUS,
+                        None,
+                        None,
+                        &mut changed,
+                    )
+                    .unwrap()
+                    .clone()
+            };
+            store.lock().unwrap().mark_consensus_usable(&meta).unwrap();
+
             let cfg = make_dirmgr_config(Some(test_authorities()));
             let mut state = GetConsensusState::new(
                 rt,
@@ -1508,10 +1820,15 @@ mod test {
             let text: crate::storage::InputString = CONSENSUS.to_owned().into();
             let map = vec![(docid, text.into())].into_iter().collect();
             let mut changed = false;
-            let outcome = state.add_from_cache(map, &mut changed);
+            let outcome = state.add_from_cache(map, Some(&store), &mut changed);
             assert!(outcome.is_ok());
             assert!(changed);
             assert!(state.can_advance());
+            let next = Box::new(state).advance();
+            assert_eq!(
+                &next.describe(),
+                "Validated consensus; about to get microdescriptors"
+            );
         });
     }
 
@@ -1579,7 +1896,7 @@ mod test {
                 .into_iter()
                 .collect();
             let mut changed = false;
-            let outcome = state.add_from_cache(docs, &mut changed);
+            let outcome = state.add_from_cache(docs, None, &mut changed);
             assert!(changed);
             assert!(outcome.is_ok()); // no error, and something changed.
             assert!(!state.can_advance()); // But we aren't done yet.
@@ -1727,7 +2044,7 @@ mod test {
                 .into_iter()
                 .collect();
             let mut changed = false;
-            let outcome = state.add_from_cache(docs, &mut changed);
+            let outcome = state.add_from_cache(docs, None, &mut changed);
             assert!(outcome.is_ok()); // successfully loaded one MD.
             assert!(changed);
             assert!(!state.can_advance());
@@ -480,6 +480,12 @@ impl Guard {
         self.exploratory_circ_pending = pending;
     }
 
+    /// Return the time at which this guard will next be retriable, if it
+    /// is currently unreachable.  (Does not consider directory status.)
+    pub(crate) fn retry_at(&self) -> Option<Instant> {
+        self.retry_at
+    }
+
     /// Possibly mark this guard as retriable, if it has been down for
     /// long enough.
     ///
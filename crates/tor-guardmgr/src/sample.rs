@@ -107,6 +107,20 @@ pub(crate) struct GuardSet {
     ///    but keeping at least one of every usable id set (actually existing bridge)
     ///    would be good.
     guards: ByRelayIds<Guard>,
+    /// A cache of the earliest `retry_at` time of any guard in `guards`,
+    /// if `retry_cache_valid` is set.
+    ///
+    /// This lets `consider_all_retries` — which runs under the guard
+    /// manager's lock for every circuit launch — return immediately in
+    /// the common case where no guard's retry time has arrived, instead
+    /// of walking (and rebuilding) the whole sample.
+    earliest_retry: Option<Instant>,
+    /// True if `earliest_retry` is up to date.
+    ///
+    /// (Never persisted; a rebuilt or deserialized sample starts out
+    /// invalid, and the first `consider_all_retries` walk re-establishes
+    /// the cache.)
+    retry_cache_valid: bool,
     /// Identities of all the guards in the sample, in sample order.
     ///
     /// This contains the same elements as the keys of `guards`
@@ -308,6 +322,8 @@ impl GuardSet {
         let primary = Vec::new();
         let mut guard_set = GuardSet {
             guards,
+            earliest_retry: None,
+            retry_cache_valid: false,
             sample,
             confirmed,
             primary,
@@ -642,6 +658,14 @@ impl GuardSet {
     /// For every guard that has been marked as `Unreachable` for too long,
     /// mark it as `Unknown`.
     pub(crate) fn consider_all_retries(&mut self, now: Instant) {
+        if self.retry_cache_valid && self.earliest_retry.map_or(true, |retry| now < retry) {
+            // No guard's retry time has arrived yet: nothing to do.  (This
+            // is the common case, and it keeps the cost of this function —
+            // which runs for every circuit launch — away from the size of
+            // the sample.)
+            return;
+        }
+
         let old_guards = std::mem::take(&mut self.guards);
         self.guards = old_guards
             .into_values()
@@ -650,6 +674,9 @@ impl GuardSet {
                 guard
             })
             .collect();
+
+        self.earliest_retry = self.guards.values().filter_map(Guard::retry_at).min();
+        self.retry_cache_valid = true;
     }
 
     /// Return the earliest time at which any guard will be retriable.
@@ -739,10 +766,24 @@ impl GuardSet {
     ) {
         // TODO use instant uniformly for in-process, and systemtime for storage?
         let is_primary = self.guard_is_primary(guard_id);
-        self.guards.modify_by_all_ids(guard_id, |guard| match how {
-            Some(external) => guard.record_external_failure(external, now),
-            None => guard.record_failure(now, is_primary),
+        let mut new_retry = None;
+        self.guards.modify_by_all_ids(guard_id, |guard| {
+            match how {
+                Some(external) => guard.record_external_failure(external, now),
+                None => guard.record_failure(now, is_primary),
+            }
+            new_retry = guard.retry_at();
         });
+        // Keep the earliest-retry cache up to date: this guard may now be
+        // the next one due for reconsideration.
+        if let Some(new_retry) = new_retry {
+            if self
+                .earliest_retry
+                .map_or(true, |earliest| new_retry < earliest)
+            {
+                self.earliest_retry = Some(new_retry);
+            }
+        }
     }
 
     /// Record that an attempt to use the guard with `guard_id` has
@@ -234,10 +234,14 @@ pub struct NetDir {
     params: NetParameters,
     /// Map from  routerstatus index (the position of a routerstatus within the
     /// consensus), to that routerstatus's microdescriptor (if we have one.)
-    mds: Vec<Option<Arc<Microdesc>>>,
+    ///
+    /// This is in an `Arc` (as are the index maps below) so that cloning a
+    /// `NetDir` for a copy-on-write update only deep-copies the structures
+    /// that the update actually modifies.
+    mds: Arc<Vec<Option<Arc<Microdesc>>>>,
     /// Map from SHA256 of _missing_ microdescriptors to the position of their
     /// corresponding routerstatus indices within `consensus`.
-    rs_idx_by_missing: HashMap<MdDigest, usize>,
+    rs_idx_by_missing: Arc<HashMap<MdDigest, usize>>,
     /// Map from ed25519 identity to index of the routerstatus within
     /// `self.consensus.relays()`.
     ///
@@ -251,7 +255,7 @@ pub struct NetDir {
     /// `MdEntry::*::rsa_idx`, it might be cool to have references instead.
     /// But that would make this into a self-referential structure,
     /// which isn't possible in safe rust.
-    rs_idx_by_ed: HashMap<Ed25519Identity, usize>,
+    rs_idx_by_ed: Arc<HashMap<Ed25519Identity, usize>>,
     /// Map from RSA identity to index of the routerstatus within
     /// `self.consensus.relays()`.
     ///
@@ -259,6 +263,15 @@ pub struct NetDir {
     /// can be immutable.
     rs_idx_by_rsa: Arc<HashMap<RsaIdentity, usize>>,
 
+    /// Map from advertised (IP, ORPort) address to the indices of the
+    /// routerstatuses within `self.consensus.relays()` that advertise it.
+    ///
+    /// More than one relay can advertise the same address.  Addresses come
+    /// from the consensus, not from microdescriptors, so (like
+    /// `rs_idx_by_rsa`) this is built once at construction time and never
+    /// changes afterward.
+    rs_idx_by_addr: Arc<HashMap<std::net::SocketAddr, Vec<usize>>>,
+
     /// Weight values to apply to a given relay when deciding how frequently
     /// to choose it for a given role.
     weights: weight::WeightSet,
@@ -487,13 +500,21 @@ impl PartialNetDir {
             .map(|(rs_idx, rs)| (*rs.rsa_identity(), rs_idx))
             .collect();
 
+        let mut rs_idx_by_addr: HashMap<std::net::SocketAddr, Vec<usize>> = HashMap::new();
+        for (rs_idx, rs) in consensus.relays().iter().enumerate() {
+            for addr in rs.orport_addrs() {
+                rs_idx_by_addr.entry(*addr).or_default().push(rs_idx);
+            }
+        }
+
         let netdir = NetDir {
             consensus: Arc::new(consensus),
             params,
-            mds: vec![None; n_relays],
-            rs_idx_by_missing,
+            mds: Arc::new(vec![None; n_relays]),
+            rs_idx_by_missing: Arc::new(rs_idx_by_missing),
             rs_idx_by_rsa: Arc::new(rs_idx_by_rsa),
-            rs_idx_by_ed: HashMap::with_capacity(n_relays),
+            rs_idx_by_addr: Arc::new(rs_idx_by_addr),
+            rs_idx_by_ed: Arc::new(HashMap::with_capacity(n_relays)),
             weights,
         };
 
@@ -556,20 +577,26 @@ impl NetDir {
     /// Return true if we wanted it, and false otherwise.
     #[allow(clippy::missing_panics_doc)] // Can't panic on valid object.
     fn add_arc_microdesc(&mut self, md: Arc<Microdesc>) -> bool {
-        if let Some(rs_idx) = self.rs_idx_by_missing.remove(md.digest()) {
+        // (Check before mutating, so that an unwanted microdescriptor does
+        // not force a copy of a shared map.)
+        if let Some(&rs_idx) = self.rs_idx_by_missing.get(md.digest()) {
             assert_eq!(self.consensus.relays()[rs_idx].md_digest(), md.digest());
 
+            let missing = Arc::make_mut(&mut self.rs_idx_by_missing);
+            missing.remove(md.digest());
+
             // There should never be two approved MDs in the same
             // consensus listing the same ID... but if there is,
             // we'll let the most recent one win.
-            self.rs_idx_by_ed.insert(*md.ed25519_id(), rs_idx);
+            Arc::make_mut(&mut self.rs_idx_by_ed).insert(*md.ed25519_id(), rs_idx);
 
             // Happy path: we did indeed want this one.
-            self.mds[rs_idx] = Some(md);
+            Arc::make_mut(&mut self.mds)[rs_idx] = Some(md);
 
             // Save some space in the missing-descriptor list.
-            if self.rs_idx_by_missing.len() < self.rs_idx_by_missing.capacity() / 4 {
-                self.rs_idx_by_missing.shrink_to_fit();
+            let missing = Arc::make_mut(&mut self.rs_idx_by_missing);
+            if missing.len() < missing.capacity() / 4 {
+                missing.shrink_to_fit();
             }
 
             return true;
@@ -746,6 +773,26 @@ impl NetDir {
         }
     }
 
+    /// Return all the usable relays advertising a given ORPort address.
+    ///
+    /// More than one relay can advertise the same address.  Addresses come
+    /// from the consensus, so this index does not have to wait for
+    /// microdescriptors to arrive.
+    #[allow(clippy::missing_panics_doc)] // Can't panic on valid object.
+    pub fn by_addr<'a>(
+        &'a self,
+        addr: &std::net::SocketAddr,
+    ) -> impl Iterator<Item = Relay<'a>> + 'a {
+        self.rs_idx_by_addr
+            .get(addr)
+            .into_iter()
+            .flatten()
+            .filter_map(move |&rs_idx| {
+                let rs = self.consensus.relays().get(rs_idx).expect("Corrupt index");
+                self.relay_from_rs_and_idx(rs, rs_idx).into_relay()
+            })
+    }
+
     /// Return a (possibly unusable) relay with a given RSA identity.
     #[allow(clippy::missing_panics_doc)] // Can't panic on valid object.
     fn by_rsa_id_unchecked(&self, rsa_id: &RsaIdentity) -> Option<UncheckedRelay<'_>> {
@@ -1583,6 +1630,30 @@ mod test {
         assert!(!r15.in_same_subnet(&r20, &subnet_config));
     }
 
+    #[test]
+    fn relay_by_addr() {
+        let (consensus, microdescs) = construct_network().unwrap();
+        let mut dir = PartialNetDir::new(consensus, None);
+        for md in microdescs.into_iter() {
+            let wanted = dir.add_microdesc(md.clone());
+            assert!(wanted);
+        }
+        let dir = dir.unwrap_if_sufficient().unwrap();
+
+        // In the test network, relays idx and idx+5, idx+10, ... all share
+        // the address [idx%5.0.0.3]:9001.
+        let addr = "1.0.0.3:9001".parse().unwrap();
+        let relays: Vec<_> = dir.by_addr(&addr).collect();
+        assert_eq!(relays.len(), 8);
+        for r in &relays {
+            assert!(r.addrs().contains(&addr));
+        }
+
+        // An address nobody advertises finds nothing.
+        let addr = "1.0.0.3:9099".parse().unwrap();
+        assert_eq!(dir.by_addr(&addr).count(), 0);
+    }
+
     #[test]
     fn test_badexit() {
         // make a netdir where relays 10-19 are badexit, and everybody
@@ -17,7 +17,7 @@ use crate::types::version::TorVersion;
 use crate::util::intern::InternCache;
 use crate::{Error, ParseErrorKind as EK, Result};
 use std::sync::Arc;
-use std::{net, time};
+use std::net;
 
 use tor_llcrypto::pk::rsa::RsaIdentity;
 use tor_protover::Protocols;
@@ -198,17 +198,31 @@ where
             ConsensusFlavor::Ns => 1,
         };
         // We check that the published time is well-formed, but we never use it
-        // for anything in a consensus document.
-        let _ignore_published: time::SystemTime = {
-            // TODO: It's annoying to have to do this allocation, since we
-            // already have a slice that contains both of these arguments.
-            // Instead, we could get a slice of arguments: we'd have to add
-            // a feature for that.
-            let mut p = r_item.required_arg(2 + n_skip)?.to_string();
-            p.push(' ');
-            p.push_str(r_item.required_arg(3 + n_skip)?);
-            p.parse::<Iso8601TimeSp>()?.into()
-        };
+        // for anything in a consensus document.  (We validate the two
+        // arguments separately so that we don't have to allocate a
+        // combined string for every relay in the consensus.)
+        {
+            use crate::Pos;
+            use ::time::format_description::FormatItem;
+            use ::time::macros::format_description;
+            /// Format for the date argument of a published time.
+            const DATE_FMT: &[FormatItem] = format_description!("[year]-[month]-[day]");
+            /// Format for the time argument of a published time.
+            const TIME_FMT: &[FormatItem] = format_description!("[hour]:[minute]:[second]");
+
+            let date_arg = r_item.required_arg(2 + n_skip)?;
+            let time_arg = r_item.required_arg(3 + n_skip)?;
+            let _ = ::time::Date::parse(date_arg, &DATE_FMT).map_err(|e| {
+                EK::BadArgument
+                    .at_pos(Pos::at(date_arg))
+                    .with_msg(format!("invalid date: {}", e))
+            })?;
+            let _ = ::time::Time::parse(time_arg, &TIME_FMT).map_err(|e| {
+                EK::BadArgument
+                    .at_pos(Pos::at(time_arg))
+                    .with_msg(format!("invalid time: {}", e))
+            })?;
+        }
         let ipv4addr = r_item.required_arg(4 + n_skip)?.parse::<net::Ipv4Addr>()?;
         let or_port = r_item.required_arg(5 + n_skip)?.parse::<u16>()?;
         let _ = r_item.required_arg(6 + n_skip)?.parse::<u16>()?;
@@ -0,0 +1,108 @@
+//! Support for benchmarking this crate's relay cryptography internals.
+//!
+//! This module is only built when the `testing` feature is enabled, and
+//! nothing in it is covered by semver guarantees: it exists so that the
+//! `benches/` harnesses can reach types that are deliberately not part of
+//! this crate's public API.
+
+use crate::crypto::cell::{
+    ClientLayer, CryptInit, InboundClientCrypt, OutboundClientCrypt, RelayCellBody, RelayCrypt,
+    Tor1RelayCrypto,
+};
+use crate::crypto::handshake::ShakeKeyGenerator as KGen;
+use tor_bytes::SecretBuf;
+
+/// The body of a relay cell, as used by the benchmark entry points below.
+pub struct BenchCellBody(RelayCellBody);
+
+impl From<[u8; 509]> for BenchCellBody {
+    fn from(body: [u8; 509]) -> Self {
+        BenchCellBody(body.into())
+    }
+}
+
+impl AsRef<[u8]> for BenchCellBody {
+    fn as_ref(&self) -> &[u8] {
+        self.0.as_ref()
+    }
+}
+
+/// Client-side relay cryptography for a three-hop circuit, together with
+/// the matching relay-side state, for benchmarking.
+pub struct ClientCryptState {
+    /// Outbound cryptographic state for the client.
+    cc_out: OutboundClientCrypt,
+    /// Inbound cryptographic state for the client.
+    cc_in: InboundClientCrypt,
+    /// Relay-side state for each hop, closest first.
+    relays: Vec<Tor1RelayCrypto>,
+}
+
+impl Default for ClientCryptState {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ClientCryptState {
+    /// Set up client and relay cryptographic state for a three-hop circuit,
+    /// using fixed key material.
+    pub fn new() -> Self {
+        /// Helper: construct a seed buffer.
+        fn s(seed: &[u8]) -> SecretBuf {
+            seed.to_vec().into()
+        }
+        let seeds = [
+            s(b"hidden we are free"),
+            s(b"free to speak, to free ourselves"),
+            s(b"free to hide no more"),
+        ];
+
+        let mut cc_out = OutboundClientCrypt::new();
+        let mut cc_in = InboundClientCrypt::new();
+        let mut relays = Vec::new();
+        for seed in seeds {
+            let (outbound, inbound) = Tor1RelayCrypto::construct(KGen::new(seed.clone()))
+                .expect("unable to construct client layer")
+                .split();
+            cc_out.add_layer(Box::new(outbound));
+            cc_in.add_layer(Box::new(inbound));
+            relays.push(
+                Tor1RelayCrypto::construct(KGen::new(seed))
+                    .expect("unable to construct relay state"),
+            );
+        }
+        ClientCryptState {
+            cc_out,
+            cc_in,
+            relays,
+        }
+    }
+
+    /// Encrypt `cell` for the last hop of the circuit, as
+    /// `OutboundClientCrypt::encrypt` would.
+    pub fn encrypt_outbound(&mut self, cell: &mut BenchCellBody) {
+        self.cc_out
+            .encrypt(&mut cell.0, 2.into())
+            .expect("encryption failed");
+    }
+
+    /// Construct an inbound cell, originated by the last hop and encrypted
+    /// by each relay on the circuit in turn.
+    pub fn make_inbound_cell(&mut self) -> BenchCellBody {
+        let mut cell = BenchCellBody([0_u8; 509].into());
+        self.relays[2].originate(&mut cell.0);
+        for relay in self.relays.iter_mut().rev() {
+            relay.encrypt_inbound(&mut cell.0);
+        }
+        cell
+    }
+
+    /// Decrypt `cell`, as `InboundClientCrypt::decrypt` would, panicking if
+    /// no layer recognizes it.
+    pub fn decrypt_inbound(&mut self, cell: &mut BenchCellBody) {
+        self.cc_in
+            .decrypt(&mut cell.0)
+            .expect("cell not recognized");
+    }
+}
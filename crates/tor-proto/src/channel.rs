@@ -342,8 +342,9 @@ impl Channel {
     where
         S: SleepProvider,
     {
-        use circmap::{CircIdRange, CircMap};
+        use circmap::{CellScheduler, CircIdRange, CircMap};
         let circmap = CircMap::new(CircIdRange::High);
+        let cell_scheduler = CellScheduler::new(circmap::DEFAULT_SCHEDULER_DECAY_PERMILLE);
 
         let (control_tx, control_rx) = mpsc::unbounded();
         let (cell_tx, cell_rx) = mpsc::channel(CHANNEL_BUFFER_SIZE);
@@ -379,6 +380,7 @@ impl Channel {
             input: futures::StreamExt::fuse(stream),
             output: sink,
             circs: circmap,
+            cell_scheduler,
             circ_unique_id_ctx: CircUniqIdContext::new(),
             link_protocol,
             details,
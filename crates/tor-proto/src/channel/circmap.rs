@@ -3,8 +3,9 @@
 // NOTE: This is a work in progress and I bet I'll refactor it a lot;
 // it needs to stay opaque!
 
+use crate::util::idhash::IdHashMap;
 use crate::{Error, Result};
-use tor_cell::chancell::CircId;
+use tor_cell::chancell::{ChanCell, CircId};
 
 use crate::circuit::celltypes::{ClientCircChanMsg, CreateResponse};
 use crate::circuit::halfcirc::HalfCirc;
@@ -13,7 +14,7 @@ use futures::channel::{mpsc, oneshot};
 
 use rand::distributions::Distribution;
 use rand::Rng;
-use std::collections::{hash_map::Entry, HashMap};
+use std::collections::{hash_map::Entry, VecDeque};
 use std::ops::{Deref, DerefMut};
 
 /// Which group of circuit IDs are we allowed to allocate in this map?
@@ -119,7 +120,10 @@ impl<'a> DerefMut for MutCircEnt<'a> {
 /// A map from circuit IDs to circuit entries. Each channel has one.
 pub(super) struct CircMap {
     /// Map from circuit IDs to entries
-    m: HashMap<CircId, CircEnt>,
+    ///
+    /// (Keyed by IDs we allocated, so the fast keyed-by-our-IDs hasher is
+    /// safe here; this map is consulted for every cell on the channel.)
+    m: IdHashMap<CircId, CircEnt>,
     /// Rule for allocating new circuit IDs.
     range: CircIdRange,
     /// Number of open or opening entry in this map.
@@ -130,7 +134,7 @@ impl CircMap {
     /// Make a new empty CircMap
     pub(super) fn new(idrange: CircIdRange) -> Self {
         CircMap {
-            m: HashMap::new(),
+            m: IdHashMap::default(),
             range: idrange,
             open_count: 0,
         }
@@ -237,6 +241,145 @@ impl CircMap {
     // circuit IDs chosen by somebody else. But for now, we don't need those.
 }
 
+/// Default per-cell decay for [`CellScheduler`] activity scores, in
+/// thousandths.
+///
+/// With a decay of 990/1000, a cell stops mattering to a circuit's score
+/// after a few hundred further cells: recently-busy bulk circuits yield to
+/// quiet interactive circuits, but the history fades quickly enough that a
+/// circuit is not punished for traffic it sent minutes ago.
+pub(super) const DEFAULT_SCHEDULER_DECAY_PERMILLE: u16 = 990;
+
+/// A scheduler for a channel's outbound cells: quietest circuit first.
+///
+/// Cells queued for transmission are held in one queue per circuit, and
+/// each circuit has an exponentially-weighted moving average of how many
+/// cells it has sent recently.  When the channel can transmit, the pending
+/// circuit with the lowest score goes first, so that an interactive
+/// circuit's cells are not stuck behind a bulk transfer's.
+///
+/// (Scores are kept as "decayed cell counts": sending a cell adds weight
+/// to the sender's score, and every score decays by a configurable factor
+/// for each cell the channel sends.)
+pub(super) struct CellScheduler {
+    /// Queued cells, per circuit, in arrival order.
+    queues: IdHashMap<CircId, VecDeque<ChanCell>>,
+    /// Activity score for each circuit we have recently sent cells for.
+    ///
+    /// Entries decay to irrelevance and are pruned during renormalization.
+    scores: IdHashMap<CircId, f64>,
+    /// The weight that sending one cell adds to a circuit's score now.
+    ///
+    /// Rather than multiplying every score by `decay` for each cell sent,
+    /// we grow the weight of newer cells by `1/decay`; the effect is
+    /// identical, and only this weight has to be updated per cell.
+    weight: f64,
+    /// Number of cells currently queued, across all circuits.
+    n_queued: usize,
+    /// Per-cell decay, in thousandths.  (See [`CellScheduler::set_decay_permille`].)
+    decay_permille: u16,
+}
+
+impl Drop for CellScheduler {
+    fn drop(&mut self) {
+        // Give back any cells still counted in the global queue-depth gauge.
+        if self.n_queued > 0 {
+            crate::metrics::adjust_chan_cells_queued(-(self.n_queued as i64));
+        }
+    }
+}
+
+impl CellScheduler {
+    /// Construct a new, empty scheduler with the given per-cell decay.
+    pub(super) fn new(decay_permille: u16) -> Self {
+        let mut sched = CellScheduler {
+            queues: IdHashMap::default(),
+            scores: IdHashMap::default(),
+            weight: 1.0,
+            n_queued: 0,
+            decay_permille: 0,
+        };
+        sched.set_decay_permille(decay_permille);
+        sched
+    }
+
+    /// Set the per-cell decay, in thousandths of a unit.
+    ///
+    /// A value of 1000 means activity never decays (scheduling degenerates
+    /// into fair round-robin); lower values prefer recent activity.  Values
+    /// are clamped to `1..=1000`.
+    pub(super) fn set_decay_permille(&mut self, decay_permille: u16) {
+        self.decay_permille = decay_permille.clamp(1, 1000);
+    }
+
+    /// Return the growth factor to apply to `self.weight` per cell sent.
+    fn growth(&self) -> f64 {
+        1000.0 / f64::from(self.decay_permille)
+    }
+
+    /// Add `cell` to the queue for its circuit.
+    pub(super) fn push(&mut self, cell: ChanCell) {
+        self.queues
+            .entry(cell.circid())
+            .or_default()
+            .push_back(cell);
+        self.n_queued += 1;
+        crate::metrics::adjust_chan_cells_queued(1);
+    }
+
+    /// Return true if no cells are queued.
+    pub(super) fn is_empty(&self) -> bool {
+        self.n_queued == 0
+    }
+
+    /// Remove and return the next cell from the pending circuit with the
+    /// lowest activity score, charging that circuit for it.
+    pub(super) fn pop_quietest(&mut self) -> Option<ChanCell> {
+        let circid = *self
+            .queues
+            .keys()
+            .min_by(|a, b| {
+                let score = |id: &CircId| self.scores.get(id).copied().unwrap_or(0.0);
+                // (Break score ties by circuit ID, for determinism.)
+                (score(a), u32::from(**a))
+                    .partial_cmp(&(score(b), u32::from(**b)))
+                    .expect("NaN in scheduler score")
+            })?;
+
+        let queue = self
+            .queues
+            .get_mut(&circid)
+            .expect("scheduler queue vanished");
+        let cell = queue.pop_front().expect("empty queue in scheduler map");
+        if queue.is_empty() {
+            self.queues.remove(&circid);
+        }
+        self.n_queued -= 1;
+        crate::metrics::adjust_chan_cells_queued(-1);
+
+        *self.scores.entry(circid).or_insert(0.0) += self.weight;
+        self.weight *= self.growth();
+        if self.weight >= 1e9 {
+            self.renormalize();
+        }
+        Some(cell)
+    }
+
+    /// Rescale all scores so that `self.weight` returns to 1.0, dropping
+    /// scores which have decayed to irrelevance.
+    ///
+    /// (Without this, `self.weight` would eventually overflow; calling it
+    /// changes no scheduling decision, since only score ratios matter.)
+    fn renormalize(&mut self) {
+        let scale = self.weight;
+        self.scores.retain(|_, score| {
+            *score /= scale;
+            *score >= 1e-12
+        });
+        self.weight = 1.0;
+    }
+}
+
 #[cfg(test)]
 mod test {
     // @@ begin test lint list maintained by maint/add_warning @@
@@ -252,6 +395,49 @@ mod test {
     use futures::channel::{mpsc, oneshot};
     use tor_basic_utils::test_rng::testing_rng;
 
+    #[test]
+    fn scheduler_prefers_quiet_circuits() {
+        use tor_cell::chancell::msg;
+
+        /// Helper: a RELAY cell for `id`.
+        fn cell(id: u32) -> ChanCell {
+            ChanCell::new(id.into(), msg::Relay::from_raw([0_u8; 509]).into())
+        }
+
+        let mut sched = CellScheduler::new(DEFAULT_SCHEDULER_DECAY_PERMILLE);
+        let bulk = CircId::from(10);
+        let quiet = CircId::from(20);
+
+        // Make the bulk circuit busy: queue and send a pile of its cells.
+        for _ in 0..20 {
+            sched.push(cell(10));
+        }
+        for _ in 0..10 {
+            assert_eq!(sched.pop_quietest().unwrap().circid(), bulk);
+        }
+
+        // A circuit with no recent activity goes ahead of the backlog.
+        sched.push(cell(20));
+        assert_eq!(sched.pop_quietest().unwrap().circid(), quiet);
+        // Even for a second cell: the bulk circuit's score dwarfs it.
+        sched.push(cell(20));
+        assert_eq!(sched.pop_quietest().unwrap().circid(), quiet);
+
+        // With the quiet circuit idle again, the backlog drains.
+        for _ in 0..10 {
+            assert_eq!(sched.pop_quietest().unwrap().circid(), bulk);
+        }
+        assert!(sched.is_empty());
+        assert!(sched.pop_quietest().is_none());
+
+        // Circuits with equal (zero) scores tie-break by circuit ID.
+        let mut sched = CellScheduler::new(DEFAULT_SCHEDULER_DECAY_PERMILLE);
+        sched.push(cell(30));
+        sched.push(cell(4));
+        assert_eq!(sched.pop_quietest().unwrap().circid(), CircId::from(4));
+        assert_eq!(sched.pop_quietest().unwrap().circid(), CircId::from(30));
+    }
+
     #[test]
     fn circmap_basics() {
         let mut map_low = CircMap::new(CircIdRange::Low);
@@ -186,6 +186,17 @@ define_channels_insns_and_automatic_impls! {
     ///
     /// [`Channel::engage_padding_activities`]: super::Channel::engage_padding_activities
     padding_negotiate: PaddingNegotiate,
+
+    /// Per-cell decay for the channel reactor's outbound circuit
+    /// scheduler, in thousandths
+    ///
+    /// The reactor services the queued cells of the quietest circuit
+    /// first, where "quiet" is judged by an exponentially-weighted moving
+    /// average of recent cell counts; this sets how quickly that average
+    /// forgets.  1000 disables the preference (every cell counts forever,
+    /// so scheduling approaches round robin).
+    #[field educe(Default(expression = "super::circmap::DEFAULT_SCHEDULER_DECAY_PERMILLE"))]
+    scheduler_decay: u16,
 }
 
 /// Builder for a channels padding instructions update
@@ -140,6 +140,12 @@ pub struct CircParameters {
     /// Whether we should include ed25519 identities when we send
     /// EXTEND2 cells.
     extend_by_ed25519_id: bool,
+    /// Maximum number of queued inbound cells the circuit reactor will
+    /// process per wakeup before yielding back to the executor.
+    cell_batch_size: usize,
+    /// Whether to run round-trip-time estimation on this circuit's hops,
+    /// based on the timing of circuit-level SENDME cells.
+    rtt_estimation: bool,
 }
 
 impl Default for CircParameters {
@@ -147,6 +153,8 @@ impl Default for CircParameters {
         CircParameters {
             initial_send_window: 1000,
             extend_by_ed25519_id: true,
+            cell_batch_size: 16,
+            rtt_estimation: true,
         }
     }
 }
@@ -185,6 +193,41 @@ impl CircParameters {
     pub fn extend_by_ed25519_id(&self) -> bool {
         self.extend_by_ed25519_id
     }
+
+    /// Override the default number of inbound cells that the reactor will
+    /// process per wakeup.  Gives an error on zero.
+    ///
+    /// Larger values amortize per-wakeup scheduling overhead over more
+    /// cells, at the cost of added latency for other tasks sharing the
+    /// executor.
+    pub fn set_cell_batch_size(&mut self, v: usize) -> Result<()> {
+        if v > 0 {
+            self.cell_batch_size = v;
+            Ok(())
+        } else {
+            Err(Error::from(bad_api_usage!(
+                "Tried to set a cell batch size of zero"
+            )))
+        }
+    }
+
+    /// Return the number of inbound cells that the reactor will process per
+    /// wakeup, as set in this parameter set.
+    pub fn cell_batch_size(&self) -> usize {
+        self.cell_batch_size
+    }
+
+    /// Override the default decision about whether to estimate round-trip
+    /// times on this circuit.
+    pub fn set_rtt_estimation(&mut self, v: bool) {
+        self.rtt_estimation = v;
+    }
+
+    /// Return true if we're configured to estimate round-trip times; false
+    /// otherwise.
+    pub fn rtt_estimation(&self) -> bool {
+        self.rtt_estimation
+    }
 }
 
 /// A stream on a particular circuit.
@@ -447,6 +490,7 @@ impl ClientCirc {
         self.unique_id
     }
 
+    /// Return the number of hops in this circuit.
     #[cfg(test)]
     pub fn n_hops(&self) -> usize {
         self.path.n_hops()
@@ -482,6 +526,7 @@ impl PendingClientCirc {
             crypto_out,
             meta_handler: None,
             path: Arc::clone(&path),
+            cell_batch_size: reactor::CELL_BATCH_SIZE_DEFAULT,
         };
 
         let circuit = ClientCirc {
@@ -1217,6 +1262,72 @@ mod test {
         });
     }
 
+    #[test]
+    fn begindir_fill_buf() {
+        // Like begindir, but consume the reply through the AsyncBufRead
+        // interface instead of copying it out with read().
+        tor_rtcompat::test_with_all_runtimes!(|rt| async move {
+            use futures::io::AsyncBufReadExt;
+
+            let (chan, mut rx, _sink) = working_fake_channel(&rt);
+            let (circ, mut sink) = newcirc(&rt, chan).await;
+
+            let begin_and_send_fut = async move {
+                let mut stream = circ.begin_dir_stream().await.unwrap();
+                stream.write_all(b"HTTP/1.0 GET /\r\n").await.unwrap();
+                stream.flush().await.unwrap();
+                // Borrow the whole reply out of the stream without copying.
+                let buf = stream.fill_buf().await.unwrap();
+                assert_eq!(buf, b"HTTP/1.0 404 Not found\r\n");
+                // Consume it in two chunks, to make sure partial consumes
+                // advance the buffer correctly.
+                stream.consume_unpin(9);
+                let buf = stream.fill_buf().await.unwrap();
+                assert_eq!(buf, b"404 Not found\r\n");
+                let n = buf.len();
+                stream.consume_unpin(n);
+                // After the END cell, fill_buf should report end-of-stream.
+                let buf = stream.fill_buf().await.unwrap();
+                assert!(buf.is_empty());
+                stream
+            };
+            let reply_fut = async move {
+                let (id, chmsg) = rx.next().await.unwrap().into_circid_and_msg();
+                assert_eq!(id, 128.into()); // hardcoded circid.
+                let rmsg = match chmsg {
+                    ChanMsg::Relay(r) => RelayCell::decode(r.into_relay_body()).unwrap(),
+                    _ => panic!(),
+                };
+                let (streamid, rmsg) = rmsg.into_streamid_and_msg();
+                assert!(matches!(rmsg, RelayMsg::BeginDir));
+
+                let connected = relaymsg::Connected::new_empty().into();
+                sink.send(rmsg_to_ccmsg(streamid, connected)).await.unwrap();
+
+                // Read the DATA cell the client sent us.
+                let (_id, chmsg) = rx.next().await.unwrap().into_circid_and_msg();
+                let rmsg = match chmsg {
+                    ChanMsg::Relay(r) => RelayCell::decode(r.into_relay_body()).unwrap(),
+                    _ => panic!(),
+                };
+                let (_streamid, rmsg) = rmsg.into_streamid_and_msg();
+                assert!(matches!(rmsg, RelayMsg::Data(_)));
+
+                let data = relaymsg::Data::new(b"HTTP/1.0 404 Not found\r\n")
+                    .unwrap()
+                    .into();
+                sink.send(rmsg_to_ccmsg(streamid, data)).await.unwrap();
+
+                let end = relaymsg::End::new_with_reason(relaymsg::EndReason::DONE).into();
+                sink.send(rmsg_to_ccmsg(streamid, end)).await.unwrap();
+
+                (rx, sink)
+            };
+
+            let (_stream, (_rx, _sink)) = futures::join!(begin_and_send_fut, reply_fut);
+        });
+    }
+
     // Set up a circuit and stream that expects some incoming SENDMEs.
     async fn setup_incoming_sendme_case<R: Runtime>(
         rt: &R,
@@ -1363,6 +1474,20 @@ mod test {
                 let (window, _tags) = rx.await.unwrap().unwrap();
                 assert_eq!(window, 1000 - 201);
             }
+
+            // RTT estimation is enabled by default, so the hop should have
+            // an estimator attached, fed from the SENDME we just processed.
+            {
+                let (tx, rx) = oneshot::channel();
+                circ.control
+                    .unbounded_send(CtrlMsg::QueryRttEstimate {
+                        hop: 2.into(),
+                        done: tx,
+                    })
+                    .unwrap();
+                let rtt = rx.await.unwrap().unwrap();
+                assert!(rtt.is_some());
+            }
         });
     }
 
@@ -14,23 +14,26 @@ use crate::{Error, Result};
 use std::collections::VecDeque;
 use std::marker::PhantomData;
 use std::pin::Pin;
-use tor_cell::chancell::msg::{ChanMsg, Relay};
+use tor_cell::chancell::msg::ChanMsg;
 use tor_cell::relaycell::msg::{End, RelayMsg, Sendme};
 use tor_cell::relaycell::{RelayCell, RelayCmd, StreamId};
 
 use futures::channel::{mpsc, oneshot};
 use futures::Sink;
 use futures::Stream;
+use tor_congestion::rtt::RoundtripTimeEstimator;
 use tor_error::internal;
 
+use std::sync::atomic::AtomicBool;
 use std::sync::Arc;
 use std::task::{Context, Poll};
+use std::time::Instant;
 
 use crate::channel::Channel;
 use crate::circuit::path;
 #[cfg(test)]
 use crate::circuit::sendme::CircTag;
-use crate::circuit::sendme::StreamSendWindow;
+use crate::circuit::sendme::{StreamSendWindow, WindowParams};
 use crate::crypto::handshake::ntor::{NtorClient, NtorPublicKey};
 use crate::crypto::handshake::{ClientHandshake, KeyGenerator};
 use tor_cell::chancell;
@@ -50,6 +53,14 @@ pub(super) const RECV_WINDOW_INIT: u16 = 500;
 ///             don't count towards the window though.
 pub(super) const STREAM_READER_BUFFER: usize = (2 * RECV_WINDOW_INIT) as usize;
 
+/// Default number of inbound cells to process per reactor wakeup.
+///
+/// Draining the input channel in batches amortizes the poll/wakeup overhead
+/// over several cells on busy circuits; the cap keeps a single firehose
+/// circuit from starving other tasks on the same executor.  This default can
+/// be overridden with [`CircParameters::set_cell_batch_size`].
+pub(super) const CELL_BATCH_SIZE_DEFAULT: usize = 16;
+
 /// The type of a oneshot channel used to inform reactor users of the result of an operation.
 pub(super) type ReactorResultChannel<T> = oneshot::Sender<Result<T>>;
 
@@ -147,6 +158,12 @@ pub(super) enum CtrlMsg {
         hop: HopNum,
         done: ReactorResultChannel<(u16, Vec<CircTag>)>,
     },
+    /// (tests only) Get the current RTT estimate for a given hop.
+    #[cfg(test)]
+    QueryRttEstimate {
+        hop: HopNum,
+        done: ReactorResultChannel<Option<std::time::Duration>>,
+    },
     /// (tests only) Send a raw relay cell with send_relay_cell().
     #[cfg(test)]
     SendRelayCell {
@@ -182,6 +199,15 @@ pub(super) struct CircHop {
     /// NOTE: Control messages could potentially add unboundedly to this, although that's
     ///       not likely to happen (and isn't triggereable from the network, either).
     outbound: VecDeque<(bool, RelayCell)>,
+    /// An estimator of the round-trip time between us and this hop, fed
+    /// from the timing of circuit-level SENDME cells, or None if RTT
+    /// estimation is disabled.
+    ///
+    /// For now this is measurement only (we log the estimate, and tests
+    /// can query it): adapting the actual send windows to it requires
+    /// negotiating prop#324 congestion control with the relay, which we
+    /// don't support yet.
+    rtt: Option<RoundtripTimeEstimator>,
 }
 
 /// Enumeration to determine whether we require circuit-level SENDME cells to be
@@ -231,13 +257,22 @@ enum CellStatus {
 
 impl CircHop {
     /// Create a new hop.
-    pub(super) fn new(auth_sendme_required: RequireSendmeAuth, initial_window: u16) -> Self {
+    pub(super) fn new(
+        auth_sendme_required: RequireSendmeAuth,
+        initial_window: u16,
+        rtt_estimation: bool,
+    ) -> Self {
         CircHop {
             map: streammap::StreamMap::new(),
             recvwindow: sendme::CircRecvWindow::new(1000),
             auth_sendme_required,
             sendwindow: sendme::CircSendWindow::new(initial_window),
             outbound: VecDeque::new(),
+            rtt: rtt_estimation.then(|| {
+                // (We have no cross-circuit clock-stall detection; give the
+                // estimator its own flag.)
+                RoundtripTimeEstimator::new_with_default_params(Arc::new(AtomicBool::new(false)))
+            }),
         }
     }
 }
@@ -464,6 +499,9 @@ pub struct Reactor {
     pub(super) channel_id: CircId,
     /// A handler for a meta cell, together with a result channel to notify on completion.
     pub(super) meta_handler: Option<(Box<dyn MetaCellHandler>, ReactorResultChannel<()>)>,
+    /// Maximum number of inbound cells to process per wakeup, as configured
+    /// with [`CircParameters::set_cell_batch_size`].
+    pub(super) cell_batch_size: usize,
 }
 
 impl Reactor {
@@ -517,22 +555,43 @@ impl Reactor {
                 }
             }
 
-            // Check whether we've got an input message pending.
-            if let Poll::Ready(ret) = Pin::new(&mut self.input).poll_next(cx) {
-                match ret {
-                    None => {
-                        trace!("{}: reactor shutdown due to input drop", self.unique_id);
-                        return Poll::Ready(Err(ReactorError::Shutdown));
+            // Check whether we've got input messages pending, and process a
+            // batch of them if so.  Draining several cells per wakeup keeps
+            // the per-cell poll and dispatch overhead down on busy circuits
+            // (and lets runs of relay cells share their decryption calls);
+            // the batch cap bounds how long we hog the executor before
+            // yielding.
+            let mut cell_batch = Vec::new();
+            let mut input_dropped = false;
+            while cell_batch.len() < self.cell_batch_size {
+                match Pin::new(&mut self.input).poll_next(cx) {
+                    Poll::Ready(None) => {
+                        // Process what we already collected before shutting
+                        // down, as the one-at-a-time path would have.
+                        input_dropped = true;
+                        break;
                     }
-                    Some(cell) => {
-                        if self.handle_cell(cx, cell)? == CellStatus::CleanShutdown {
-                            trace!("{}: reactor shutdown due to handled cell", self.unique_id);
-                            return Poll::Ready(Err(ReactorError::Shutdown));
-                        }
-                        did_things = true;
+                    Poll::Ready(Some(cell)) => {
+                        crate::metrics::note_circ_cell_received();
+                        cell_batch.push(cell);
                     }
+                    Poll::Pending => break,
                 }
             }
+            if !cell_batch.is_empty() {
+                did_things = true;
+                if self.handle_cell_batch(cx, cell_batch)? == CellStatus::CleanShutdown {
+                    trace!("{}: reactor shutdown due to handled cell", self.unique_id);
+                    return Poll::Ready(Err(ReactorError::Shutdown));
+                }
+            }
+            if input_dropped {
+                trace!("{}: reactor shutdown due to input drop", self.unique_id);
+                return Poll::Ready(Err(ReactorError::Shutdown));
+            }
+            // (If we stopped because we hit the batch cap, `did_things` is set,
+            // so we'll return `Ready` below and get run again promptly to
+            // process any cells still queued.)
 
             // Now for the tricky part. We want to grab some relay cells from all of our streams
             // and forward them on to the channel, but we need to pay attention to both whether
@@ -707,6 +766,9 @@ impl Reactor {
         // function consumes the PendingClientCirc and only returns
         // a ClientCirc on success.
 
+        // Pick up any per-circuit tuning before we start processing cells.
+        self.cell_batch_size = params.cell_batch_size();
+
         let (state, msg) = {
             // done like this because holding the RNG across an await boundary makes the future
             // non-Send
@@ -813,6 +875,7 @@ impl Reactor {
         let hop = crate::circuit::reactor::CircHop::new(
             require_sendme_auth,
             params.initial_send_window(),
+            params.rtt_estimation(),
         );
         self.hops.push(hop);
         self.crypto_in.add_layer(rev);
@@ -882,6 +945,7 @@ impl Reactor {
     fn handle_sendme(&mut self, hopnum: HopNum, msg: Sendme) -> Result<CellStatus> {
         // No need to call "shutdown" on errors in this function;
         // it's called from the reactor task and errors will propagate there.
+        let unique_id = self.unique_id;
         let hop = self
             .hop_mut(hopnum)
             .ok_or_else(|| Error::CircProto(format!("Couldn't find {} hop", hopnum)))?;
@@ -903,6 +967,20 @@ impl Reactor {
             }
         };
         hop.sendwindow.put(auth)?;
+        if let Some(rtt) = &mut hop.rtt {
+            // Under the fixed-window scheme, the congestion window is the
+            // (constant) circuit-level window maximum.
+            let cwnd = u64::from(sendme::CircParams::maximum());
+            match rtt.sendme_received(Instant::now(), cwnd) {
+                Ok(()) => trace!(
+                    "{}: RTT estimate for hop {} is now {:?}",
+                    unique_id,
+                    hopnum,
+                    rtt.estimate_rtt()
+                ),
+                Err(e) => debug!("{}: RTT estimation failed: {}", unique_id, e),
+            }
+        }
         Ok(CellStatus::Continue)
     }
 
@@ -1002,6 +1080,7 @@ impl Reactor {
             .map_err(|e| Error::from_cell_enc(e, "relay cell body"))?
             .into();
         let tag = self.crypto_out.encrypt(&mut body, hop)?;
+        crate::metrics::note_circ_cell_sent();
         // NOTE(eta): Now that we've encrypted the cell, we *must* either send it or abort
         //            the whole circuit (e.g. by returning an error).
         let msg = chancell::msg::Relay::from_raw(body.into());
@@ -1016,7 +1095,16 @@ impl Reactor {
             let hop_num = Into::<usize>::into(hop);
             let hop = &mut self.hops[hop_num];
             // checked by earlier conditional, so this shouldn't fail
-            hop.sendwindow.take(tag)?;
+            let new_window = hop.sendwindow.take(tag)?;
+            if new_window % sendme::CircParams::increment() == 0 {
+                // We just sent the cell that a future circuit-level SENDME
+                // will acknowledge; note the time, for RTT estimation.
+                // (This matches the condition under which take() records
+                // an authentication tag.)
+                if let Some(rtt) = &mut hop.rtt {
+                    rtt.expect_sendme(Instant::now());
+                }
+            }
             if !stream_id.is_zero() {
                 // We need to decrement the stream-level sendme window.
                 // Stream data cells should only be dequeued and fed into this function if
@@ -1133,6 +1221,17 @@ impl Reactor {
                 let _ = done.send(Ok(()));
             }
             #[cfg(test)]
+            CtrlMsg::QueryRttEstimate { hop, done } => {
+                let _ = done.send(if let Some(hop) = self.hop_mut(hop) {
+                    Ok(hop.rtt.as_ref().map(RoundtripTimeEstimator::estimate_rtt))
+                } else {
+                    Err(Error::from(internal!(
+                        "received QueryRttEstimate for unknown hop {:?}",
+                        hop
+                    )))
+                });
+            }
+            #[cfg(test)]
             CtrlMsg::QuerySendWindow { hop, done } => {
                 let _ = done.send(if let Some(hop) = self.hop_mut(hop) {
                     Ok(hop.sendwindow.window_and_expected_tags())
@@ -1200,46 +1299,70 @@ impl Reactor {
         Ok(())
     }
 
-    /// Helper: process a cell on a channel.  Most cells get ignored
-    /// or rejected; a few get delivered to circuits.
+    /// Helper: process a batch of cells from a channel.  Most cells get
+    /// ignored or rejected; a few get delivered to circuits.
     ///
-    /// Return true if we should exit.
-    fn handle_cell(&mut self, cx: &mut Context<'_>, cell: ClientCircChanMsg) -> Result<CellStatus> {
-        trace!("{}: handling cell: {:?}", self.unique_id, cell);
+    /// Runs of consecutive RELAY cells within the batch are decrypted
+    /// together through [`InboundClientCrypt::decrypt_batch`], so that
+    /// each crypto layer runs back-to-back over the whole run.
+    fn handle_cell_batch(
+        &mut self,
+        cx: &mut Context<'_>,
+        cells: Vec<ClientCircChanMsg>,
+    ) -> Result<CellStatus> {
         use ClientCircChanMsg::*;
-        match cell {
-            Relay(r) => Ok(self.handle_relay_cell(cx, r)?),
-            Destroy(d) => {
-                let reason = d.reason();
-                debug!(
-                    "{}: Received DESTROY cell. Reason: {} [{}]",
-                    self.unique_id,
-                    reason.human_str(),
-                    reason
-                );
+        let mut cells = cells.into_iter().peekable();
+        while let Some(cell) = cells.next() {
+            trace!("{}: handling cell: {:?}", self.unique_id, cell);
+            match cell {
+                Relay(r) => {
+                    // Gather the run of relay cells that starts here, and
+                    // decrypt it as one batch.
+                    let mut bodies: Vec<RelayCellBody> = vec![r.into_relay_body().into()];
+                    while bodies.len() < self.cell_batch_size {
+                        match cells.peek() {
+                            Some(Relay(_)) => match cells.next() {
+                                Some(Relay(r)) => bodies.push(r.into_relay_body().into()),
+                                _ => unreachable!("peeked cell disappeared"),
+                            },
+                            _ => break,
+                        }
+                    }
+                    let decrypted = self.crypto_in.decrypt_batch(&mut bodies)?;
+                    for (body, (hopnum, tag)) in bodies.into_iter().zip(decrypted) {
+                        if self.handle_relay_cell_body(cx, body, hopnum, tag)?
+                            == CellStatus::CleanShutdown
+                        {
+                            return Ok(CellStatus::CleanShutdown);
+                        }
+                    }
+                }
+                Destroy(d) => {
+                    let reason = d.reason();
+                    debug!(
+                        "{}: Received DESTROY cell. Reason: {} [{}]",
+                        self.unique_id,
+                        reason.human_str(),
+                        reason
+                    );
 
-                self.handle_destroy_cell()?;
-                Ok(CellStatus::CleanShutdown)
+                    self.handle_destroy_cell()?;
+                    return Ok(CellStatus::CleanShutdown);
+                }
             }
         }
+        Ok(CellStatus::Continue)
     }
 
-    /// React to a Relay or RelayEarly cell.
-    fn handle_relay_cell(&mut self, cx: &mut Context<'_>, cell: Relay) -> Result<CellStatus> {
-        let mut body = cell.into_relay_body().into();
-
-        // Decrypt the cell. If it's recognized, then find the
-        // corresponding hop.
-        let (hopnum, tag) = self.crypto_in.decrypt(&mut body)?;
-        // Make a copy of the authentication tag. TODO: I'd rather not
-        // copy it, but I don't see a way around it right now.
-        let tag = {
-            let mut tag_copy = [0_u8; 20];
-            // TODO(nickm): This could crash if the tag length changes.  We'll
-            // have to refactor it then.
-            tag_copy.copy_from_slice(tag);
-            tag_copy
-        };
+    /// React to a decrypted Relay or RelayEarly cell body, which `hopnum`
+    /// originated with the authentication tag `tag`.
+    fn handle_relay_cell_body(
+        &mut self,
+        cx: &mut Context<'_>,
+        body: RelayCellBody,
+        hopnum: HopNum,
+        tag: [u8; 20],
+    ) -> Result<CellStatus> {
         // Decode the cell.
         let msg =
             RelayCell::decode(body.into()).map_err(|e| Error::from_bytes_err(e, "relay cell"))?;
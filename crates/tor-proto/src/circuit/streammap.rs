@@ -8,9 +8,9 @@ use crate::{Error, Result};
 // it needs to stay opaque!
 use tor_cell::relaycell::{msg::RelayMsg, StreamId};
 
+use crate::util::idhash::IdHashMap;
 use futures::channel::mpsc;
 use std::collections::hash_map::Entry;
-use std::collections::HashMap;
 use tor_error::internal;
 
 use rand::Rng;
@@ -75,7 +75,10 @@ pub(super) enum ShouldSendEnd {
 pub(super) struct StreamMap {
     /// Map from StreamId to StreamEnt.  If there is no entry for a
     /// StreamId, that stream doesn't exist.
-    m: HashMap<StreamId, StreamEnt>,
+    ///
+    /// (Keyed by IDs we allocated, so the fast keyed-by-our-IDs hasher is
+    /// safe here; this map is consulted for every cell on every stream.)
+    m: IdHashMap<StreamId, StreamEnt>,
     /// The next StreamId that we should use for a newly allocated
     /// circuit.  (0 is not a valid streamID).
     next_stream_id: u16,
@@ -92,13 +95,13 @@ impl StreamMap {
             }
         };
         StreamMap {
-            m: HashMap::new(),
+            m: IdHashMap::default(),
             next_stream_id,
         }
     }
 
-    /// Get the `HashMap` inside this stream map.
-    pub(super) fn inner(&mut self) -> &mut HashMap<StreamId, StreamEnt> {
+    /// Get the map inside this stream map.
+    pub(super) fn inner(&mut self) -> &mut IdHashMap<StreamId, StreamEnt> {
         &mut self.m
     }
 
@@ -88,6 +88,17 @@ pub(crate) trait OutboundClientLayer {
     fn originate_for(&mut self, cell: &mut RelayCellBody) -> &[u8];
     /// Encrypt a RelayCellBody to be decrypted by this layer.
     fn encrypt_outbound(&mut self, cell: &mut RelayCellBody);
+    /// Encrypt a batch of RelayCellBodies to be decrypted by this layer,
+    /// in order.
+    ///
+    /// This is equivalent to calling `encrypt_outbound` on each cell in
+    /// turn; implementations can override it to keep the cipher pipeline
+    /// full across cells.
+    fn encrypt_outbound_batch(&mut self, cells: &mut [RelayCellBody]) {
+        for cell in cells {
+            self.encrypt_outbound(cell);
+        }
+    }
 }
 
 /// A client's view of the crypto state shared with a single relay, as
@@ -172,6 +183,46 @@ impl OutboundClientCrypt {
         Ok(tag.try_into().expect("wrong SENDME digest size"))
     }
 
+    /// Prepare a batch of cell bodies to be sent away from the client.
+    ///
+    /// As with `encrypt`, every cell is prepared for the `hop`th hop and
+    /// encrypted with the appropriate keys; cells are processed layer-major
+    /// (every cell at each layer before moving outward), so each layer's
+    /// cipher runs back-to-back over the whole batch.  This produces the
+    /// same bytes as encrypting each cell in order with `encrypt`.
+    ///
+    /// On success, returns one expected SENDME authentication tag per cell,
+    /// in the same order as `cells`.
+    //
+    // The circuit reactor has no caller for this yet: outbound cells are
+    // produced one at a time, with circuit- and stream-window bookkeeping
+    // between each, so there is never a ready-made batch to encrypt.
+    // Batching the send path would mean restructuring that scheduling,
+    // not just switching the crypto call.
+    #[allow(dead_code)]
+    pub(crate) fn encrypt_batch(
+        &mut self,
+        cells: &mut [RelayCellBody],
+        hop: HopNum,
+    ) -> Result<Vec<[u8; 20]>> {
+        let hop: usize = hop.into();
+        if hop >= self.layers.len() {
+            return Err(Error::NoSuchHop);
+        }
+
+        let mut layers = self.layers.iter_mut().take(hop + 1).rev();
+        let first_layer = layers.next().ok_or(Error::NoSuchHop)?;
+        let mut tags = Vec::with_capacity(cells.len());
+        for cell in cells.iter_mut() {
+            let tag = first_layer.originate_for(cell);
+            tags.push(tag.try_into().expect("wrong SENDME digest size"));
+        }
+        for layer in layers {
+            layer.encrypt_outbound_batch(cells);
+        }
+        Ok(tags)
+    }
+
     /// Add a new layer to this OutboundClientCrypt
     pub(crate) fn add_layer(&mut self, layer: Box<dyn OutboundClientLayer + Send>) {
         assert!(self.layers.len() < std::u8::MAX as usize);
@@ -202,6 +253,32 @@ impl InboundClientCrypt {
         }
         Err(Error::BadCellAuth)
     }
+    /// Decrypt a batch of incoming cells that are coming to the client.
+    ///
+    /// On success, return the originating hop and a copy of the
+    /// authentication tag for each cell, in the same order as `cells`.
+    ///
+    /// Unlike the outbound direction, inbound cells must be processed
+    /// cell-major: each cell has to be checked for recognition at every
+    /// layer before we know where it stops, so there is no layer-width
+    /// cipher call to make here.  This method exists so callers that batch
+    /// inbound cells have a single entry point, and fails on the first cell
+    /// that no layer recognizes.
+    pub(crate) fn decrypt_batch(
+        &mut self,
+        cells: &mut [RelayCellBody],
+    ) -> Result<Vec<(HopNum, [u8; 20])>> {
+        let mut ret = Vec::with_capacity(cells.len());
+        for cell in cells.iter_mut() {
+            let (hopnum, tag) = self.decrypt(cell)?;
+            let tag = tag
+                .try_into()
+                .map_err(|_| internal!("wrong SENDME digest size"))?;
+            ret.push((hopnum, tag));
+        }
+        Ok(ret)
+    }
+
     /// Add a new layer to this InboundClientCrypt
     pub(crate) fn add_layer(&mut self, layer: Box<dyn InboundClientLayer + Send>) {
         assert!(self.layers.len() < std::u8::MAX as usize);
@@ -492,6 +569,94 @@ mod test {
         }
     }
 
+    #[test]
+    fn batch_roundtrip() {
+        // Make sure that the batch encrypt/decrypt paths produce exactly
+        // the same bytes (and tags) as the cell-at-a-time paths.
+        use crate::crypto::handshake::ShakeKeyGenerator as KGen;
+        fn s(seed: &[u8]) -> SecretBuf {
+            seed.to_vec().into()
+        }
+        fn layers(seeds: &[SecretBuf]) -> (OutboundClientCrypt, InboundClientCrypt) {
+            let mut cc_out = OutboundClientCrypt::new();
+            let mut cc_in = InboundClientCrypt::new();
+            for seed in seeds {
+                let pair = Tor1RelayCrypto::construct(KGen::new(seed.clone())).unwrap();
+                add_layers(&mut cc_out, &mut cc_in, pair);
+            }
+            (cc_out, cc_in)
+        }
+
+        let seeds = vec![
+            s(b"hidden we are free"),
+            s(b"free to speak, to free ourselves"),
+            s(b"free to hide no more"),
+        ];
+        // Two independent copies of the same circuit state: one will
+        // encrypt cell-at-a-time, the other will use the batch entry point.
+        let (mut cc_out_single, mut cc_in_single) = layers(&seeds);
+        let (mut cc_out_batch, mut cc_in_batch) = layers(&seeds);
+
+        let mut rng = testing_rng();
+        let mut batch: Vec<RelayCellBody> = Vec::new();
+        for _ in 0..7 {
+            let mut body = [0_u8; 509];
+            rng.fill_bytes(&mut body);
+            batch.push(body.into());
+        }
+        let mut single = batch.clone();
+
+        let mut single_tags = Vec::new();
+        for cell in single.iter_mut() {
+            single_tags.push(*cc_out_single.encrypt(cell, 2.into()).unwrap());
+        }
+        let batch_tags = cc_out_batch.encrypt_batch(&mut batch, 2.into()).unwrap();
+
+        assert_eq!(single_tags, batch_tags);
+        for (s, b) in single.iter().zip(batch.iter()) {
+            assert_eq!(s.as_ref(), b.as_ref());
+        }
+
+        // For the inbound direction, build cells as a relay would and make
+        // sure batch decryption agrees with cell-at-a-time decryption.
+        let mut r_states: Vec<_> = seeds
+            .iter()
+            .map(|sd| Tor1RelayCrypto::construct(KGen::new(sd.clone())).unwrap())
+            .collect();
+        let mut batch: Vec<RelayCellBody> = Vec::new();
+        for _ in 0..7 {
+            let mut body = [0_u8; 509];
+            rng.fill_bytes(&mut body);
+            let mut cell: RelayCellBody = body.into();
+            r_states[2].originate(&mut cell);
+            for r in r_states.iter_mut().rev() {
+                r.encrypt_inbound(&mut cell);
+            }
+            batch.push(cell);
+        }
+        let mut single = batch.clone();
+
+        let mut single_results = Vec::new();
+        for cell in single.iter_mut() {
+            let (hop, tag) = cc_in_single.decrypt(cell).unwrap();
+            single_results.push((hop, <[u8; 20]>::try_from(tag).unwrap()));
+        }
+        let batch_results = cc_in_batch.decrypt_batch(&mut batch).unwrap();
+
+        assert_eq!(single_results, batch_results);
+        for (s, b) in single.iter().zip(batch.iter()) {
+            assert_eq!(s.as_ref(), b.as_ref());
+        }
+
+        // Batch encryption to a nonexistent hop should fail, just as the
+        // single-cell path does.
+        let mut cells = vec![RelayCellBody::from([0_u8; 509])];
+        assert!(matches!(
+            cc_out_batch.encrypt_batch(&mut cells, 10.into()),
+            Err(Error::NoSuchHop)
+        ));
+    }
+
     // From tor's test_relaycrypt.c
 
     #[test]
@@ -37,9 +37,12 @@
 #![allow(clippy::result_large_err)] // temporary workaround for arti#587
 //! <!-- @@ end lint list maintained by maint/add_warning @@ -->
 
+#[cfg(feature = "testing")]
+pub mod bench_utils;
 pub mod channel;
 pub mod circuit;
 mod crypto;
+pub mod metrics;
 pub mod stream;
 mod util;
 
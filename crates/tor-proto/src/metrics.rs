@@ -0,0 +1,86 @@
+//! Cheap global counters for hot-path instrumentation.
+//!
+//! These are plain relaxed atomics: incrementing one is a single
+//! uncontended atomic add, with no locks and no formatting, so they are
+//! cheap enough to leave enabled in production.  They are process-global
+//! (like [`time_since_last_incoming_traffic`](crate::time_since_last_incoming_traffic)),
+//! and are exported so that an application can surface them to an
+//! operator, e.g. over a metrics endpoint.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// Total number of cells processed by circuit reactors (inbound).
+static CIRC_CELLS_RECEIVED: AtomicU64 = AtomicU64::new(0);
+/// Total number of cells encrypted and sent by circuit reactors.
+static CIRC_CELLS_SENT: AtomicU64 = AtomicU64::new(0);
+/// Total number of cells received by channel reactors.
+static CHAN_CELLS_RECEIVED: AtomicU64 = AtomicU64::new(0);
+/// Total number of cells written to channels by channel reactors.
+static CHAN_CELLS_SENT: AtomicU64 = AtomicU64::new(0);
+/// Number of cells currently buffered in channel reactors' outbound
+/// schedulers, across all channels.  (A gauge, not a counter.)
+static CHAN_CELLS_QUEUED: AtomicU64 = AtomicU64::new(0);
+
+/// Note that a circuit reactor has processed an inbound cell.
+#[inline]
+pub(crate) fn note_circ_cell_received() {
+    CIRC_CELLS_RECEIVED.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Note that a circuit reactor has encrypted and sent a cell.
+#[inline]
+pub(crate) fn note_circ_cell_sent() {
+    CIRC_CELLS_SENT.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Note that a channel reactor has received a cell.
+#[inline]
+pub(crate) fn note_chan_cell_received() {
+    CHAN_CELLS_RECEIVED.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Note that a channel reactor has written a cell to its channel.
+#[inline]
+pub(crate) fn note_chan_cell_sent() {
+    CHAN_CELLS_SENT.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Adjust the global count of cells queued in channel schedulers by
+/// `delta`.
+#[inline]
+pub(crate) fn adjust_chan_cells_queued(delta: i64) {
+    // (Relaxed wrapping arithmetic: transient small inaccuracies are fine
+    // for a gauge, and it can never tear.)
+    CHAN_CELLS_QUEUED.fetch_add(delta as u64, Ordering::Relaxed);
+}
+
+/// A snapshot of the hot-path counters maintained by this crate.
+#[derive(Debug, Clone, Default)]
+#[non_exhaustive]
+pub struct ProtoMetrics {
+    /// Total cells processed by circuit reactors (inbound).
+    pub circ_cells_received: u64,
+    /// Total cells encrypted and sent by circuit reactors.
+    pub circ_cells_sent: u64,
+    /// Total cells received by channel reactors.
+    pub chan_cells_received: u64,
+    /// Total cells written to channels by channel reactors.
+    pub chan_cells_sent: u64,
+    /// Cells currently queued in channel reactors' outbound schedulers.
+    pub chan_cells_queued: u64,
+}
+
+/// Return a snapshot of this crate's hot-path counters.
+///
+/// The counters are read individually with relaxed ordering, so the
+/// snapshot is not a single consistent cut across all of them; that is
+/// fine for monitoring.
+pub fn metrics() -> ProtoMetrics {
+    ProtoMetrics {
+        circ_cells_received: CIRC_CELLS_RECEIVED.load(Ordering::Relaxed),
+        circ_cells_sent: CIRC_CELLS_SENT.load(Ordering::Relaxed),
+        chan_cells_received: CHAN_CELLS_RECEIVED.load(Ordering::Relaxed),
+        chan_cells_sent: CHAN_CELLS_SENT.load(Ordering::Relaxed),
+        chan_cells_queued: CHAN_CELLS_QUEUED.load(Ordering::Relaxed),
+    }
+}
@@ -4,7 +4,7 @@
 use crate::{Error, Result};
 use tor_cell::relaycell::msg::EndReason;
 
-use futures::io::{AsyncRead, AsyncWrite};
+use futures::io::{AsyncBufRead, AsyncRead, AsyncWrite};
 use futures::task::{Context, Poll};
 use futures::Future;
 
@@ -34,7 +34,10 @@ use tor_error::internal;
 ///
 /// [`DataStream`] implements [`futures::io::AsyncRead`] and
 /// [`futures::io::AsyncWrite`], so you can use it anywhere that those
-/// traits are expected.
+/// traits are expected.  It also implements [`futures::io::AsyncBufRead`]:
+/// `poll_fill_buf` yields a borrowed view of the most recently received
+/// DATA payload, so callers that copy the data onward themselves (like a
+/// proxy writing to a local socket) can consume it without an extra copy.
 ///
 /// # Examples
 ///
@@ -124,7 +127,8 @@ pub struct DataWriter {
     state: Option<DataWriterState>,
 }
 
-/// The read half of a [`DataStream`], implementing [`futures::io::AsyncRead`].
+/// The read half of a [`DataStream`], implementing [`futures::io::AsyncRead`]
+/// and [`futures::io::AsyncBufRead`].
 ///
 /// See the [`DataStream`] docs for more information.
 ///
@@ -161,6 +165,7 @@ impl DataStream {
                 pending: Vec::new(),
                 offset: 0,
                 connected: false,
+                eof: false,
             })),
         };
         let w = DataWriter {
@@ -217,6 +222,15 @@ impl AsyncRead for DataStream {
     }
 }
 
+impl AsyncBufRead for DataStream {
+    fn poll_fill_buf(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<IoResult<&[u8]>> {
+        AsyncBufRead::poll_fill_buf(Pin::new(&mut self.get_mut().r), cx)
+    }
+    fn consume(self: Pin<&mut Self>, amt: usize) {
+        AsyncBufRead::consume(Pin::new(&mut self.get_mut().r), amt);
+    }
+}
+
 #[cfg(feature = "tokio")]
 impl TokioAsyncRead for DataStream {
     fn poll_read(
@@ -496,6 +510,11 @@ struct DataReaderImpl {
 
     /// If true, we have received a CONNECTED cell on this stream.
     connected: bool,
+
+    /// If true, we have reached a clean end-of-stream, and `poll_fill_buf`
+    /// should keep reporting it (as an empty buffer) instead of trying to
+    /// read another cell.
+    eof: bool,
 }
 
 impl AsyncRead for DataReader {
@@ -513,8 +532,9 @@ impl AsyncRead for DataReader {
                 DataReaderState::Ready(mut imp) => {
                     // There may be data to read already.
                     let n_copied = imp.extract_bytes(buf);
-                    if n_copied != 0 {
-                        // We read data into the buffer.  Tell the caller.
+                    if n_copied != 0 || imp.eof {
+                        // We read data into the buffer, or we had already
+                        // seen a clean end-of-stream: tell the caller.
                         self.state = Some(DataReaderState::Ready(imp));
                         return Poll::Ready(Ok(n_copied));
                     }
@@ -558,6 +578,87 @@ impl AsyncRead for DataReader {
     }
 }
 
+impl AsyncBufRead for DataReader {
+    fn poll_fill_buf(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<IoResult<&[u8]>> {
+        let this = self.get_mut();
+        // We're pulling the state object out of the reader.  We MUST
+        // put it back before this function returns.
+        let mut state = this.state.take().expect("Missing state in DataReader");
+
+        loop {
+            let mut future = match state {
+                DataReaderState::Ready(imp) => {
+                    if !imp.buf_is_empty() || imp.eof {
+                        // There's data to yield (or a stable end-of-stream
+                        // to report): break out, and borrow the buffer
+                        // below (we can't return a borrow of `imp` from
+                        // here, since it's about to be moved back into
+                        // `this.state`).
+                        state = DataReaderState::Ready(imp);
+                        break;
+                    }
+
+                    // No data available!  We have to launch a read.
+                    Box::pin(imp.read_cell())
+                }
+                DataReaderState::ReadingCell(fut) => fut,
+                DataReaderState::Closed => {
+                    this.state = Some(DataReaderState::Closed);
+                    return Poll::Ready(Err(Error::NotConnected.into()));
+                }
+            };
+
+            // We have a future that represents an in-progress read.
+            // See if it can make progress.
+            match future.as_mut().poll(cx) {
+                Poll::Ready((mut imp, Err(e))) => {
+                    if matches!(e, Error::EndReceived(EndReason::DONE)) {
+                        // A clean end-of-stream is reported as an empty
+                        // buffer.  Remember it, so that later calls keep
+                        // reporting it rather than trying to read past it.
+                        imp.eof = true;
+                        this.state = Some(DataReaderState::Ready(imp));
+                        return Poll::Ready(Ok(&[][..]));
+                    }
+                    // There aren't any survivable errors in the current
+                    // design.
+                    this.state = Some(DataReaderState::Closed);
+                    return Poll::Ready(Err(e.into()));
+                }
+                Poll::Ready((imp, Ok(()))) => {
+                    // It read a cell!  Continue the loop.
+                    state = DataReaderState::Ready(imp);
+                }
+                Poll::Pending => {
+                    // The future is pending; store it and tell the
+                    // caller to get back to us later.
+                    this.state = Some(DataReaderState::ReadingCell(future));
+                    return Poll::Pending;
+                }
+            }
+        }
+
+        this.state = Some(state);
+        match this.state.as_ref() {
+            Some(DataReaderState::Ready(imp)) => Poll::Ready(Ok(&imp.pending[imp.offset..])),
+            _ => Poll::Ready(Err(Error::from(internal!(
+                "DataReader state changed unexpectedly"
+            ))
+            .into())),
+        }
+    }
+
+    fn consume(self: Pin<&mut Self>, amt: usize) {
+        let this = self.get_mut();
+        if let Some(DataReaderState::Ready(imp)) = this.state.as_mut() {
+            // Don't allow consuming past the end of the pending data.
+            imp.offset = std::cmp::min(imp.offset + amt, imp.pending.len());
+        }
+        // Consuming on a closed reader, or one with a read in progress,
+        // is a no-op: there is no buffer to consume from.
+    }
+}
+
 #[cfg(feature = "tokio")]
 impl TokioAsyncRead for DataReader {
     fn poll_read(
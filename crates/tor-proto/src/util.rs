@@ -2,5 +2,6 @@
 
 pub(crate) mod ct;
 pub(crate) mod err;
+pub(crate) mod idhash;
 pub(crate) mod skew;
 pub(crate) mod ts;
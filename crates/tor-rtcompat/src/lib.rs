@@ -47,6 +47,7 @@ pub mod task;
 mod compound;
 mod opaque;
 pub mod scheduler;
+pub mod wheel;
 mod timer;
 mod traits;
 
@@ -0,0 +1,215 @@
+//! A coarse, coalescing timer facility.
+//!
+//! A [`TimerWheel`] lets many tasks wait for deadlines while arming only
+//! one underlying runtime timer at a time.  Deadlines are rounded up to
+//! the wheel's tick granularity, so deadlines that land in the same tick
+//! share a single runtime wakeup.  This keeps a client with thousands of
+//! per-channel and per-circuit timers from fragmenting the runtime's
+//! timer structures and waking constantly.
+//!
+//! The price is precision: a timer registered with a wheel fires up to
+//! one granularity-interval late.  Use a wheel only for deadlines that
+//! can tolerate that (padding, expirations, retries), and pick the
+//! granularity accordingly.
+
+use crate::SleepProvider;
+use futures::channel::{mpsc, oneshot};
+use futures::task::{Spawn, SpawnError, SpawnExt};
+use futures::{select_biased, FutureExt, StreamExt};
+use std::cmp::Reverse;
+use std::collections::BinaryHeap;
+use std::future::Future;
+use std::pin::Pin;
+use std::task::{Context, Poll};
+use std::time::{Duration, Instant};
+
+/// A handle to a shared coarse timer.
+///
+/// Handles are cheap to clone; all clones feed the same driver task.  The
+/// driver exits when every handle is dropped.
+#[derive(Clone)]
+pub struct TimerWheel {
+    /// Channel on which we send new deadlines to the driver task.
+    cmd_tx: mpsc::UnboundedSender<WheelEntry>,
+}
+
+/// A deadline registered on a [`TimerWheel`].
+struct WheelEntry {
+    /// When the waiter should be woken.
+    deadline: Instant,
+    /// How to wake the waiter.
+    notify: oneshot::Sender<()>,
+}
+
+/// A future returned by [`TimerWheel::sleep_at`].
+///
+/// Resolves once the wheel tick containing the deadline has fired.  (If
+/// the wheel's driver has shut down, resolves immediately rather than
+/// hanging its caller.)
+pub struct WheelSleep {
+    /// The notification we are waiting for.
+    rx: oneshot::Receiver<()>,
+}
+
+impl Future for WheelSleep {
+    type Output = ();
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        // Both a normal firing and a vanished driver resolve the future.
+        Pin::new(&mut self.rx).poll(cx).map(|_| ())
+    }
+}
+
+impl TimerWheel {
+    /// Create a new timer wheel with the given tick `granularity`,
+    /// spawning its driver task via `runtime`.
+    ///
+    /// (A zero granularity is treated as one millisecond.)
+    pub fn new<R>(runtime: &R, granularity: Duration) -> Result<Self, SpawnError>
+    where
+        R: SleepProvider + Spawn + Clone + Send + 'static,
+    {
+        let granularity = std::cmp::max(granularity, Duration::from_millis(1));
+        let (cmd_tx, cmd_rx) = mpsc::unbounded();
+        runtime.spawn(run_driver(runtime.clone(), granularity, cmd_rx))?;
+        Ok(TimerWheel { cmd_tx })
+    }
+
+    /// Return a future that resolves within one wheel tick after
+    /// `deadline`.
+    pub fn sleep_at(&self, deadline: Instant) -> WheelSleep {
+        let (notify, rx) = oneshot::channel();
+        // If the driver is gone, dropping `notify` here resolves the
+        // future immediately; there is nothing more useful to do.
+        let _ = self.cmd_tx.unbounded_send(WheelEntry { deadline, notify });
+        WheelSleep { rx }
+    }
+}
+
+/// The driver task for a [`TimerWheel`]: keep track of every registered
+/// deadline, and arm one runtime timer for the next occupied tick.
+async fn run_driver<R: SleepProvider>(
+    runtime: R,
+    granularity: Duration,
+    mut cmd_rx: mpsc::UnboundedReceiver<WheelEntry>,
+) {
+    // Queued deadlines, earliest first.  (The sequence number keeps the
+    // heap total-ordered without comparing senders.)
+    let mut heap: BinaryHeap<Reverse<(Instant, u64)>> = BinaryHeap::new();
+    // Notifiers for queued deadlines, by sequence number.
+    let mut notifiers: std::collections::HashMap<u64, oneshot::Sender<()>> =
+        std::collections::HashMap::new();
+    let mut next_seq: u64 = 0;
+    let epoch = runtime.now();
+
+    /// Helper: enqueue one entry.
+    fn register(
+        entry: WheelEntry,
+        heap: &mut BinaryHeap<Reverse<(Instant, u64)>>,
+        notifiers: &mut std::collections::HashMap<u64, oneshot::Sender<()>>,
+        next_seq: &mut u64,
+    ) {
+        let seq = *next_seq;
+        *next_seq += 1;
+        heap.push(Reverse((entry.deadline, seq)));
+        notifiers.insert(seq, entry.notify);
+    }
+
+    loop {
+        let earliest = match heap.peek() {
+            Some(&Reverse((deadline, _))) => deadline,
+            None => {
+                // Nothing queued: wait for a registration (or shutdown).
+                match cmd_rx.next().await {
+                    Some(entry) => {
+                        register(entry, &mut heap, &mut notifiers, &mut next_seq);
+                        continue;
+                    }
+                    None => return,
+                }
+            }
+        };
+
+        // Round the earliest deadline up to the next tick boundary, so
+        // that everything in the same tick shares this wakeup.
+        let since_epoch = earliest.saturating_duration_since(epoch).as_nanos();
+        let g = granularity.as_nanos();
+        let ticks = since_epoch / g + 1;
+        let tick_end = epoch
+            + Duration::from_nanos(u64::try_from(ticks.saturating_mul(g)).unwrap_or(u64::MAX));
+        let delay = tick_end.saturating_duration_since(runtime.now());
+
+        select_biased! {
+            cmd = cmd_rx.next() => {
+                match cmd {
+                    Some(entry) => register(entry, &mut heap, &mut notifiers, &mut next_seq),
+                    // Every handle is gone; wake all remaining waiters
+                    // (dropping a notifier resolves its future) and exit.
+                    None => return,
+                }
+            }
+            _ = runtime.sleep(delay).fuse() => {
+                let now = runtime.now();
+                while let Some(&Reverse((deadline, seq))) = heap.peek() {
+                    if deadline > now {
+                        break;
+                    }
+                    let _ = heap.pop();
+                    if let Some(notify) = notifiers.remove(&seq) {
+                        // (An error here just means the waiter went away.)
+                        let _ = notify.send(());
+                    }
+                }
+            }
+        }
+    }
+}
+
+#[cfg(all(test, any(feature = "tokio", feature = "async-std")))]
+mod test {
+    // @@ begin test lint list maintained by maint/add_warning @@
+    #![allow(clippy::bool_assert_comparison)]
+    #![allow(clippy::clone_on_copy)]
+    #![allow(clippy::dbg_macro)]
+    #![allow(clippy::print_stderr)]
+    #![allow(clippy::print_stdout)]
+    #![allow(clippy::single_char_pattern)]
+    #![allow(clippy::unwrap_used)]
+    //! <!-- @@ end test lint list maintained by maint/add_warning @@ -->
+    use super::*;
+
+    #[test]
+    fn wheel_fires_deadlines() {
+        crate::test_with_all_runtimes!(|rt| async move {
+            let wheel = TimerWheel::new(&rt, Duration::from_millis(10)).unwrap();
+            let start = rt.now();
+
+            // Several deadlines, out of registration order, including one
+            // in the past.
+            let s1 = wheel.sleep_at(start + Duration::from_millis(25));
+            let s2 = wheel.sleep_at(start);
+            let s3 = wheel.sleep_at(start + Duration::from_millis(5));
+
+            s2.await;
+            s3.await;
+            assert!(rt.now() >= start + Duration::from_millis(5));
+            s1.await;
+            let elapsed = rt.now() - start;
+            // Fired no earlier than asked...
+            assert!(elapsed >= Duration::from_millis(25));
+            // ... and within a (very generous, for CI) lateness bound.
+            assert!(elapsed < Duration::from_secs(5));
+        });
+    }
+
+    #[test]
+    fn wheel_dropped() {
+        crate::test_with_all_runtimes!(|rt| async move {
+            let wheel = TimerWheel::new(&rt, Duration::from_millis(10)).unwrap();
+            let sleep = wheel.sleep_at(rt.now() + Duration::from_secs(3600));
+            drop(wheel);
+            // With every handle gone, the driver exits and pending sleeps
+            // resolve rather than hanging forever.
+            sleep.await;
+        });
+    }
+}
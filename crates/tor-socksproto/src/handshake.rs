@@ -29,6 +29,74 @@ pub struct Action {
     pub finished: bool,
 }
 
+/// As [`Action`], but with the reply written into a caller-provided
+/// buffer instead of a freshly allocated `Vec`.
+///
+/// Returned by [`SocksProxyHandshake::handshake_into`](crate::SocksProxyHandshake::handshake_into).
+#[derive(Clone, Copy, Debug)]
+#[non_exhaustive]
+pub struct BufAction {
+    /// If nonzero, this many bytes should be drained from the
+    /// client's inputs.
+    pub drain: usize,
+    /// How many bytes of the caller's reply buffer were filled in.
+    /// (Zero means there is nothing to send.)
+    pub reply_len: usize,
+    /// If true, then this handshake is over, either successfully or not.
+    pub finished: bool,
+}
+
+/// The result of one handshake step, with the (always tiny) reply stored
+/// inline, so that taking a step allocates nothing.
+#[derive(Clone, Copy, Debug, Default)]
+pub(crate) struct Step {
+    /// How many bytes of input this step consumed.
+    pub(crate) drain: usize,
+    /// The bytes of the reply to send, if any.
+    reply: [u8; Step::MAX_REPLY],
+    /// How many bytes of `reply` are meaningful.
+    reply_len: u8,
+    /// Whether the handshake is over.
+    pub(crate) finished: bool,
+}
+
+impl Step {
+    /// Largest reply any single proxy-side handshake step can produce.
+    const MAX_REPLY: usize = 2;
+
+    /// Construct a new Step.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `reply` is longer than `MAX_REPLY` bytes; no proxy-side
+    /// step produces more.
+    pub(crate) fn new(drain: usize, reply: &[u8], finished: bool) -> Self {
+        let mut buf = [0_u8; Step::MAX_REPLY];
+        buf[..reply.len()].copy_from_slice(reply);
+        Step {
+            drain,
+            reply: buf,
+            reply_len: reply.len() as u8,
+            finished,
+        }
+    }
+
+    /// Return the reply bytes to send.
+    pub(crate) fn reply(&self) -> &[u8] {
+        &self.reply[..usize::from(self.reply_len)]
+    }
+}
+
+impl From<Step> for Action {
+    fn from(step: Step) -> Action {
+        Action {
+            drain: step.drain,
+            reply: step.reply().to_vec(),
+            finished: step.finished,
+        }
+    }
+}
+
 impl Readable for SocksAddr {
     fn take_from(r: &mut Reader<'_>) -> BytesResult<SocksAddr> {
         let atype = r.take_u8()?;
@@ -148,8 +216,56 @@ mod test_roundtrip {
         panic!("Handshake ran for too many steps")
     }
 
+    /// As `run_handshake`, but drive the proxy side through the
+    /// buffer-based `handshake_into` API, checking that it behaves just
+    /// like `handshake`.
+    fn run_handshake_into(request: SocksRequest, status: SocksStatus) -> (SocksRequest, SocksReply) {
+        let mut client_hs = SocksClientHandshake::new(request);
+        let mut proxy_hs = SocksProxyHandshake::new();
+        let mut received_request = None;
+
+        let mut last_proxy_msg = vec![];
+        let mut replybuf = [0_u8; 16];
+        // Prevent infinite loop in case of bugs.
+        for _ in 0..100 {
+            let client_action = client_hs.handshake(&last_proxy_msg).unwrap().unwrap();
+            assert_eq!(client_action.drain, last_proxy_msg.len());
+            if client_action.finished {
+                let received_reply = client_hs.into_reply();
+                return (received_request.unwrap(), received_reply.unwrap());
+            }
+            let client_msg = client_action.reply;
+
+            // Truncated inputs still say "truncated".
+            for truncate in 0..client_msg.len() {
+                let r = proxy_hs.handshake_into(&client_msg[..truncate], &mut replybuf[..]);
+                assert!(r.is_err());
+            }
+            let proxy_action = proxy_hs
+                .handshake_into(&client_msg, &mut replybuf[..])
+                .unwrap()
+                .unwrap();
+            assert_eq!(proxy_action.drain, client_msg.len());
+            last_proxy_msg = if proxy_action.finished {
+                received_request = proxy_hs.clone().into_request();
+                received_request
+                    .as_ref()
+                    .unwrap()
+                    .reply(status, None)
+                    .unwrap()
+            } else {
+                replybuf[..proxy_action.reply_len].to_vec()
+            };
+        }
+        panic!("Handshake ran for too many steps")
+    }
+
     // Invoke run_handshake and assert that the output matches the input.
     fn test_handshake(request: &SocksRequest, status: SocksStatus) {
+        // Both proxy-side APIs must give the same results.
+        let (request_out, status_out) = run_handshake_into(request.clone(), status);
+        assert_eq!(&request_out, request);
+        assert_eq!(status_out.status(), status);
         let (request_out, status_out) = run_handshake(request.clone(), status);
         assert_eq!(&request_out, request);
         assert_eq!(status_out.status(), status);
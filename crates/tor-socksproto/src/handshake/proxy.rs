@@ -1,6 +1,6 @@
 //! Types to implement the SOCKS handshake.
 
-use super::Action;
+use super::{Action, BufAction, Step};
 use crate::msg::{SocksAddr, SocksAuth, SocksCmd, SocksRequest, SocksStatus, SocksVersion};
 use crate::{Error, Result, TResult, Truncated};
 
@@ -71,6 +71,45 @@ impl SocksProxyHandshake {
     /// On success, return an Action describing what to tell the client,
     /// and how much of its input to consume.
     pub fn handshake(&mut self, input: &[u8]) -> TResult<Action> {
+        match self.handshake_step(input) {
+            Ok(Ok(step)) => Ok(Ok(step.into())),
+            Ok(Err(e)) => Ok(Err(e)),
+            Err(trunc) => Err(trunc),
+        }
+    }
+
+    /// As [`handshake`](Self::handshake), but write any reply into the
+    /// caller-provided `reply` buffer instead of allocating one.
+    ///
+    /// The buffer must be at least two bytes long (no proxy-side step
+    /// replies with more); the number of bytes to send back is given by
+    /// [`BufAction::reply_len`].  A normal handshake step performed
+    /// through this method allocates nothing until the final request is
+    /// assembled.
+    pub fn handshake_into(&mut self, input: &[u8], reply: &mut [u8]) -> TResult<BufAction> {
+        match self.handshake_step(input) {
+            Ok(Ok(step)) => {
+                let step_reply = step.reply();
+                if reply.len() < step_reply.len() {
+                    return Ok(Err(
+                        internal!("reply buffer too small for handshake reply").into()
+                    ));
+                }
+                reply[..step_reply.len()].copy_from_slice(step_reply);
+                Ok(Ok(BufAction {
+                    drain: step.drain,
+                    reply_len: step_reply.len(),
+                    finished: step.finished,
+                }))
+            }
+            Ok(Err(e)) => Ok(Err(e)),
+            Err(trunc) => Err(trunc),
+        }
+    }
+
+    /// Helper for `handshake` and `handshake_into`: advance the handshake
+    /// by one step.
+    fn handshake_step(&mut self, input: &[u8]) -> TResult<Step> {
         if input.is_empty() {
             return Err(Truncated::new());
         }
@@ -99,7 +138,7 @@ impl SocksProxyHandshake {
     }
 
     /// Complete a socks4 or socks4a handshake.
-    fn s4(&mut self, input: &[u8]) -> Result<Action> {
+    fn s4(&mut self, input: &[u8]) -> Result<Step> {
         let mut r = Reader::from_slice(input);
         let version = r.take_u8()?.try_into()?;
         if version != SocksVersion::V4 {
@@ -136,15 +175,11 @@ impl SocksProxyHandshake {
         self.state = State::Done;
         self.handshake = Some(request);
 
-        Ok(Action {
-            drain: r.consumed(),
-            reply: Vec::new(),
-            finished: true,
-        })
+        Ok(Step::new(r.consumed(), &[], true))
     }
 
     /// Socks5: initial handshake to negotiate authentication method.
-    fn s5_initial(&mut self, input: &[u8]) -> Result<Action> {
+    fn s5_initial(&mut self, input: &[u8]) -> Result<Step> {
         use super::{NO_AUTHENTICATION, USERNAME_PASSWORD};
         let mut r = Reader::from_slice(input);
         let version: SocksVersion = r.take_u8()?.try_into()?;
@@ -167,15 +202,11 @@ impl SocksProxyHandshake {
         };
 
         self.state = next;
-        Ok(Action {
-            drain: r.consumed(),
-            reply: reply.into(),
-            finished: false,
-        })
+        Ok(Step::new(r.consumed(), &reply, false))
     }
 
     /// Socks5: second step for username/password authentication.
-    fn s5_uname(&mut self, input: &[u8]) -> Result<Action> {
+    fn s5_uname(&mut self, input: &[u8]) -> Result<Step> {
         let mut r = Reader::from_slice(input);
 
         let ver = r.take_u8()?;
@@ -192,15 +223,11 @@ impl SocksProxyHandshake {
 
         self.socks5_auth = Some(SocksAuth::Username(username.into(), passwd.into()));
         self.state = State::Socks5Wait;
-        Ok(Action {
-            drain: r.consumed(),
-            reply: vec![1, 0],
-            finished: false,
-        })
+        Ok(Step::new(r.consumed(), &[1, 0], false))
     }
 
     /// Socks5: final step, to receive client's request.
-    fn s5(&mut self, input: &[u8]) -> Result<Action> {
+    fn s5(&mut self, input: &[u8]) -> Result<Step> {
         let mut r = Reader::from_slice(input);
 
         let version: SocksVersion = r.take_u8()?.try_into()?;
@@ -224,11 +251,7 @@ impl SocksProxyHandshake {
         self.state = State::Done;
         self.handshake = Some(request);
 
-        Ok(Action {
-            drain: r.consumed(),
-            reply: Vec::new(),
-            finished: true,
-        })
+        Ok(Step::new(r.consumed(), &[], true))
     }
 
     /// Return true if this handshake is finished.
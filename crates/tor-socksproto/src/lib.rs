@@ -42,7 +42,7 @@ mod handshake;
 mod msg;
 
 pub use err::Error;
-pub use handshake::Action;
+pub use handshake::{Action, BufAction};
 
 #[cfg(feature = "proxy-handshake")]
 #[cfg_attr(docsrs, doc(cfg(feature = "proxy-handshake")))]